@@ -0,0 +1,79 @@
+/**
+ * Sequential control flows without blocking.
+ *
+ * On the controller, flows are protothreads: a function written top to bottom that
+ * returns whenever it has to wait and resumes at the same line on its next call.
+ * Resuming is a switch on the line number saved in a Protothread (8 bytes), so no
+ * stack is kept between calls:
+ *
+ *   PT_THREAD(blink(Protothread &pt)) {
+ *     PT_BEGIN(pt);
+ *     for (;;) {
+ *       digitalWrite(LED, HIGH);
+ *       PT_SLEEP(pt, 500);
+ *       digitalWrite(LED, LOW);
+ *       PT_WAIT_UNTIL(pt, buttonPressed());
+ *     }
+ *     PT_END(pt);
+ *   }
+ *
+ * The price of being stackless: locals do not survive a wait (keep state in
+ * globals or the owning struct), a flow may not contain its own switch, and
+ * each wait needs a line of its own.
+ *
+ * The host simulator runs the same protothreads rather than C++20 coroutines.
+ * A Lot, controller included, is copied to fork it and saved byte for byte by
+ * sim/checkpoint.h; a coroutine keeps its frame on the heap behind a handle,
+ * which neither survives a byte copy nor can be written to a checkpoint.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#ifndef PT_CLOCK
+#define PT_CLOCK() millis()
+#endif
+
+struct Protothread {
+  uint16_t line = 0;                  // Resume point; 0 = start
+  uint32_t timer = 0;                 // PT_SLEEP start time
+};
+
+#define PT_WAITING  0
+#define PT_ENDED    1
+
+#define PT_THREAD(signature)  uint8_t signature
+
+#define PT_BEGIN(pt)  switch ((pt).line) { case 0:
+
+#define PT_END(pt)  } (pt).line = 0; return PT_ENDED
+
+// Returns to the caller until cond holds, re-testing it on every call
+#define PT_WAIT_UNTIL(pt, cond)         \
+  do {                                  \
+    (pt).line = __LINE__;               \
+    [[fallthrough]];                    \
+    case __LINE__:                      \
+    if (!(cond)) return PT_WAITING;     \
+  } while (0)
+
+#define PT_SLEEP(pt, ms)                \
+  do {                                  \
+    (pt).timer = PT_CLOCK();            \
+    PT_WAIT_UNTIL(pt, (uint32_t)(PT_CLOCK() - (pt).timer) >= (uint32_t)(ms)); \
+  } while (0)
+
+// Gives up the rest of this call once, then continues
+#define PT_YIELD(pt)                    \
+  do {                                  \
+    (pt).line = __LINE__;               \
+    return PT_WAITING;                  \
+    case __LINE__:;                     \
+  } while (0)
+
+// Starts over from PT_BEGIN on the next call
+#define PT_RESTART(pt)                  \
+  do {                                  \
+    (pt).line = 0;                      \
+    return PT_WAITING;                  \
+  } while (0)
@@ -0,0 +1,61 @@
+/**
+ * Compile-time wired publish/subscribe between controller modules.
+ *
+ * Each event type gets one EventChannel whose subscribers are template arguments,
+ * so dispatch is a sequence of direct (usually inlined) calls: no virtual calls,
+ * no function-pointer tables and no heap. Published events wait in a fixed ring
+ * buffer until dispatch(), which decouples the producer's timing from whatever
+ * the subscribers do. Adding a subscriber only touches its own channel's wiring;
+ * other events do not pay for it.
+ *
+ *   EventChannel<CardRead, 4, grantAccess, journalCard> cardChannel;
+ *   cardChannel.publish({ tag, true });      // Producer
+ *   cardChannel.dispatch();                  // From the scheduler
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+template<class Event, uint8_t Capacity, void (*...Subscribers)(const Event &)>
+class EventChannel {
+  static_assert(Capacity && Capacity <= 128 && (Capacity & (Capacity - 1)) == 0,
+                "Capacity must be a power of two up to 128");
+
+ public:
+  /**
+   * Queues an event; returns false (and counts a drop) if the ring is full.
+   */
+  bool publish(const Event &event) {
+    if ((uint8_t)(head_ - tail_) == Capacity) {
+      dropped_++;
+      return false;
+    }
+    ring_[head_++ & (Capacity - 1)] = event;
+    return true;
+  }
+
+  /**
+   * Delivers every queued event, oldest first, to all subscribers in wiring order.
+   * Events published by a subscriber during dispatch are delivered in the same call.
+   */
+  void dispatch() {
+    while (tail_ != head_) {
+      const Event &event = ring_[tail_ & (Capacity - 1)];
+      deliver(event);
+      tail_++;
+    }
+  }
+
+  // Calls the subscribers directly, bypassing the queue
+  static void deliver(const Event &event) { (Subscribers(event), ...); }
+
+  uint8_t pending() const { return head_ - tail_; }
+  uint16_t dropped() const { return dropped_; }
+
+ private:
+  Event ring_[Capacity];
+  uint8_t head_ = 0;                  // Free-running; wraps at 256, a multiple of Capacity
+  uint8_t tail_ = 0;
+  uint16_t dropped_ = 0;
+};
@@ -0,0 +1,203 @@
+/**
+ * export_journal – bulk-exports the controller journal into a columnar history directory.
+ *
+ *   export_journal <device> <history-dir> [window]
+ *
+ * The history directory holds one little-endian file per column, all with the same
+ * row count:
+ *
+ *   boot.u32  seq.u32  stamp.u32  type.u8  arg.u8  value.u16
+ *
+ * stamp is stored as sent (see Journal Timestamps in protocol.h). boot is the
+ * controller's random boot ID; seq restarts at 0 whenever it changes.
+ *
+ * Rows are appended in sequence order, so an interrupted export resumes from the
+ * last stored boot and seq + 1; after a controller reboot it starts again at seq 0
+ * of the new boot. A torn final row (columns of unequal length) is trimmed on
+ * startup. Records the controller overwrote before they could be fetched show up
+ * as gaps in the seq column.
+ *
+ * Build: g++ -std=c++17 -O2 -I.. -o export_journal export_journal.cpp parking_link.cpp
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "parking_link.h"
+
+#define EXPORT_WINDOW_DEFAULT  8
+#define EXPORT_TIMEOUT_MS    1000             // No frame for this long: re-issue the request
+#define EXPORT_MAX_RETRIES      5
+
+struct Column {
+  const char *name;
+  size_t width;
+  FILE *file;
+};
+
+static Column columns[] = {
+  { "boot.u32", 4, nullptr },
+  { "seq.u32", 4, nullptr },
+  { "stamp.u32", 4, nullptr },
+  { "type.u8", 1, nullptr },
+  { "arg.u8", 1, nullptr },
+  { "value.u16", 2, nullptr },
+};
+static const size_t columnCount = sizeof(columns) / sizeof(columns[0]);
+
+static double nowSec() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Opens every column for appending after trimming them to a common row count.
+ * Returns the boot and seq to resume from.
+ */
+static bool openHistory(const char *dir, uint32_t &resumeBoot, uint32_t &resumeSeq) {
+  if (mkdir(dir, 0755) != 0 && errno != EEXIST) return false;
+
+  char path[512];
+  snprintf(path, sizeof(path), "%s/time_ms.u32", dir);
+  if (access(path, F_OK) == 0) {
+    fprintf(stderr, "%s holds an older layout (time_ms.u32); export into a new directory\n", dir);
+    errno = EEXIST;
+    return false;
+  }
+  snprintf(path, sizeof(path), "%s/seq.u32", dir);
+  char bootPath[512];
+  snprintf(bootPath, sizeof(bootPath), "%s/boot.u32", dir);
+  struct stat seqSt;
+  if (stat(path, &seqSt) == 0 && seqSt.st_size > 0 && access(bootPath, F_OK) != 0) {
+    fprintf(stderr, "%s predates boot.u32; export into a new directory\n", dir);
+    errno = EEXIST;
+    return false;
+  }
+
+  long rows = -1;
+  for (Column &col : columns) {
+    snprintf(path, sizeof(path), "%s/%s", dir, col.name);
+    struct stat st;
+    long n = stat(path, &st) == 0 ? (long)(st.st_size / col.width) : 0;
+    if (rows < 0 || n < rows) rows = n;
+  }
+
+  for (Column &col : columns) {
+    snprintf(path, sizeof(path), "%s/%s", dir, col.name);
+    col.file = fopen(path, "a+b");
+    if (!col.file || ftruncate(fileno(col.file), rows * col.width) != 0) return false;
+  }
+
+  resumeBoot = resumeSeq = 0;
+  if (rows > 0) {
+    uint32_t last;
+    fseek(columns[0].file, (rows - 1) * 4, SEEK_SET);
+    fseek(columns[1].file, (rows - 1) * 4, SEEK_SET);
+    if (fread(&resumeBoot, 4, 1, columns[0].file) != 1 || fread(&last, 4, 1, columns[1].file) != 1) return false;
+    resumeSeq = last + 1;
+  }
+  for (Column &col : columns) fseek(col.file, 0, SEEK_END);
+  return true;
+}
+
+static void appendRecord(uint32_t boot, const JournalRecord &rec) {
+  fwrite(&boot, 4, 1, columns[0].file);
+  fwrite(&rec.seq, 4, 1, columns[1].file);
+  fwrite(&rec.stamp, 4, 1, columns[2].file);
+  fwrite(&rec.type, 1, 1, columns[3].file);
+  fwrite(&rec.arg, 1, 1, columns[4].file);
+  fwrite(&rec.value, 2, 1, columns[5].file);
+}
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s <device> <history-dir> [window]\n", argv[0]);
+    return 2;
+  }
+  uint8_t window = argc > 3 ? atoi(argv[3]) : EXPORT_WINDOW_DEFAULT;
+
+  uint32_t boot, expected;
+  if (!openHistory(argv[2], boot, expected)) {
+    perror(argv[2]);
+    return 1;
+  }
+
+  const char *baudEnv = getenv("PARKCTL_BAUD");
+  ParkingLink link;
+  if (!link.open(argv[1], baudEnv ? strtoul(baudEnv, nullptr, 10) : 1000000)) {
+    perror(argv[1]);
+    return 1;
+  }
+
+  uint32_t records = 0, skipped = 0;
+  size_t bytes = 0;
+  double started = nowSec();
+  int retries = 0;
+  bool done = false;
+  ExportReq req = { boot, expected, window };
+  link.send(MSG_EXPORT_REQ, &req, sizeof(req));
+
+  while (!done) {
+    Frame frame;
+    if (!link.receive(frame, EXPORT_TIMEOUT_MS)) {
+      if (++retries > EXPORT_MAX_RETRIES) {
+        fprintf(stderr, "controller stopped responding; rerun to resume from seq %u\n", expected);
+        break;
+      }
+      req.bootId = boot;                   // Resume where the stored history ends
+      req.fromSeq = expected;
+      link.send(MSG_EXPORT_REQ, &req, sizeof(req));
+      continue;
+    }
+    retries = 0;
+
+    if (frame.type == MSG_ACK && frame.length == sizeof(AckMsg) && frame.payload[0] == MSG_EXPORT_REQ) {
+      fprintf(stderr, "export rejected (status %u)\n", frame.payload[1]);
+      break;
+    }
+    if (frame.type == MSG_EXPORT_END) {
+      done = true;
+      break;
+    }
+    if (frame.type != MSG_EXPORT_DATA || frame.length < sizeof(ExportData) + sizeof(JournalRecord)) continue;
+
+    ExportData header;
+    JournalRecord rec;
+    memcpy(&header, frame.payload, sizeof(header));
+    memcpy(&rec, frame.payload + sizeof(header), sizeof(rec));
+    if (header.bootId != boot) {
+      // The controller rebooted since the stored history ends; its seqs started over
+      boot = header.bootId;
+      expected = 0;
+    }
+
+    // Accept only the next frame in order; anything else is re-acked so the
+    // controller falls back to the first record we are missing
+    bool lost = expected < header.oldestSeq && rec.seq == header.oldestSeq;
+    if (rec.seq == expected || lost) {
+      if (lost) skipped += header.oldestSeq - expected;
+      for (size_t off = sizeof(header); off + sizeof(rec) <= frame.length; off += sizeof(rec)) {
+        memcpy(&rec, frame.payload + off, sizeof(rec));
+        appendRecord(boot, rec);
+        expected = rec.seq + 1;
+        records++;
+      }
+      bytes += frame.length;
+    }
+    ExportAck ack = { expected };
+    link.send(MSG_EXPORT_ACK, &ack, sizeof(ack));
+  }
+
+  for (Column &col : columns) fclose(col.file);
+
+  double elapsed = nowSec() - started;
+  fprintf(stderr, "%u records (%zu payload bytes) in %.2f s, %.0f records/s%s\n",
+          records, bytes, elapsed, elapsed > 0 ? records / elapsed : 0.0, done ? "" : " (incomplete)");
+  if (skipped) fprintf(stderr, "%u records were overwritten on the controller before export\n", skipped);
+  return done ? 0 : 1;
+}
@@ -0,0 +1,80 @@
+/**
+ * ntp_standin – minimal SNTP server for testing the controller's time sync on a LAN.
+ *
+ *   ntp_standin [port] [offset-ms] [drift-ppm]
+ *
+ * Answers every client request with the host clock shifted by offset-ms and skewed
+ * by drift-ppm since startup, so step corrections and drift learning can be
+ * exercised without touching the host's own time. Point NTP_SERVER in main.c++
+ * at this machine. Binding port 123 usually needs root; NTP_PORT can be changed
+ * to match a higher port instead.
+ *
+ * Build: g++ -std=c++17 -O2 -o ntp_standin ntp_standin.cpp
+ */
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+
+#define NTP_UNIX_OFFSET  2208988800ULL          // Seconds from 1900 to 1970
+
+static double wallSec() {
+  timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void putTimestamp(uint8_t *p, double unixSec) {
+  uint64_t seconds = (uint64_t)unixSec;
+  uint32_t fraction = (uint32_t)((unixSec - seconds) * 4294967296.0);
+  uint32_t ntpSeconds = (uint32_t)(seconds + NTP_UNIX_OFFSET);
+  uint32_t be[2] = { htonl(ntpSeconds), htonl(fraction) };
+  memcpy(p, be, 8);
+}
+
+int main(int argc, char **argv) {
+  int port = argc > 1 ? atoi(argv[1]) : 123;
+  double offsetSec = argc > 2 ? atof(argv[2]) / 1e3 : 0;
+  double driftPpm = argc > 3 ? atof(argv[3]) : 0;
+
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(port);
+  if (fd < 0 || bind(fd, (sockaddr *)&addr, sizeof(addr)) != 0) {
+    perror("bind");
+    return 1;
+  }
+
+  double start = wallSec();
+  auto served = [&](double t) { return t + offsetSec + (t - start) * driftPpm / 1e6; };
+  printf("serving on udp/%d, offset %.3f s, drift %.1f ppm\n", port, offsetSec, driftPpm);
+
+  for (;;) {
+    uint8_t packet[48];
+    sockaddr_in client;
+    socklen_t clientLen = sizeof(client);
+    ssize_t n = recvfrom(fd, packet, sizeof(packet), 0, (sockaddr *)&client, &clientLen);
+    double received = served(wallSec());
+    if (n < 48 || (packet[0] & 0x07) != 3) continue;     // Client mode only
+
+    uint8_t reply[48] = {};
+    reply[0] = (packet[0] & 0x38) | 4;                   // LI 0, client's version, server mode
+    reply[1] = 1;                                        // Stratum 1: reference clock
+    reply[2] = packet[2];
+    reply[3] = (uint8_t)-20;                             // ~1 µs precision
+    memcpy(reply + 12, "LOCL", 4);
+    putTimestamp(reply + 16, received);                  // Reference
+    memcpy(reply + 24, packet + 40, 8);                  // Originate = client transmit
+    putTimestamp(reply + 32, received);                  // Receive
+    putTimestamp(reply + 40, served(wallSec()));         // Transmit
+    sendto(fd, reply, sizeof(reply), 0, (sockaddr *)&client, clientLen);
+    printf("%s:%u\n", inet_ntoa(client.sin_addr), ntohs(client.sin_port));
+    fflush(stdout);
+  }
+}
@@ -0,0 +1,240 @@
+/**
+ * ota_delta – builds firmware deltas and pushes them to a controller over the serial link.
+ *
+ *   ota_delta diff <base.bin> <target.bin> <out.delta>
+ *   ota_delta push <device> <update.delta>
+ *
+ * diff emits COPY ops for every stretch of the target found in the base (greedy
+ * longest match through a hash index of 8-byte windows, trying the continuation of
+ * the previous match first) and ADD ops for the rest, then re-applies the delta
+ * in memory and checks the target digest before writing it.
+ *
+ * push streams the delta in acknowledged chunks (the controller programs flash
+ * between chunks, with interrupts off), has the controller verify the rebuilt
+ * image, activates it and reports how long the controller was unreachable.
+ *
+ * Build: g++ -std=c++17 -O2 -I.. -o ota_delta ota_delta.cpp parking_link.cpp
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <unordered_map>
+#include <vector>
+
+#include "ota_delta.h"
+#include "parking_link.h"
+
+#define MATCH_WINDOW       8                  // Bytes hashed per index entry
+#define MIN_COPY          12                  // Shorter matches cost more than they save
+#define MAX_CANDIDATES    32                  // Index entries tried per position
+#define CHUNK_BYTES      (PROTO_MAX_PAYLOAD - sizeof(OtaData))
+#define CHUNK_RETRIES      5
+
+typedef std::vector<uint8_t> Bytes;
+
+static bool readFile(const char *path, Bytes &out) {
+  FILE *f = fopen(path, "rb");
+  if (!f) return false;
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + n);
+  fclose(f);
+  return true;
+}
+
+static double nowMs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static uint64_t windowKey(const uint8_t *p) {
+  uint64_t key;
+  memcpy(&key, p, sizeof(key));
+  return key;
+}
+
+static void put16(Bytes &out, uint16_t v) {
+  out.push_back(v & 0xFF);
+  out.push_back(v >> 8);
+}
+
+static void put32(Bytes &out, uint32_t v) {
+  put16(out, v & 0xFFFF);
+  put16(out, v >> 16);
+}
+
+static void flushLiteral(Bytes &out, const uint8_t *data, size_t len) {
+  while (len) {
+    uint16_t run = len > DELTA_MAX_RUN ? DELTA_MAX_RUN : len;
+    out.push_back(DELTA_OP_ADD);
+    put16(out, run);
+    out.insert(out.end(), data, data + run);
+    data += run;
+    len -= run;
+  }
+}
+
+struct VectorSink {
+  Bytes &out;
+  bool write(const uint8_t *data, size_t len) {
+    out.insert(out.end(), data, data + len);
+    return true;
+  }
+};
+
+static int diff(const char *basePath, const char *targetPath, const char *outPath) {
+  Bytes base, target;
+  if (!readFile(basePath, base) || !readFile(targetPath, target)) {
+    perror("read");
+    return 1;
+  }
+
+  std::unordered_multimap<uint64_t, uint32_t> index;
+  index.reserve(base.size());
+  for (size_t i = 0; i + MATCH_WINDOW <= base.size(); i++) index.emplace(windowKey(&base[i]), i);
+
+  DeltaHeader header = {};
+  header.magic = DELTA_MAGIC;
+  header.baseLength = base.size();
+  header.targetLength = target.size();
+  Sha256 sha;
+  sha.update(base.data(), base.size());
+  sha.finish(header.baseSha256);
+  sha.reset();
+  sha.update(target.data(), target.size());
+  sha.finish(header.targetSha256);
+
+  Bytes ops;
+  size_t pos = 0, literalStart = 0, nextSrc = 0;
+  auto matchLength = [&](size_t src) {
+    size_t n = 0;
+    while (pos + n < target.size() && src + n < base.size() && n < DELTA_MAX_RUN && base[src + n] == target[pos + n]) n++;
+    return n;
+  };
+  while (pos < target.size()) {
+    size_t bestLen = matchLength(nextSrc), bestSrc = nextSrc;
+    if (bestLen < MIN_COPY && pos + MATCH_WINDOW <= target.size()) {
+      auto range = index.equal_range(windowKey(&target[pos]));
+      int tried = 0;
+      for (auto it = range.first; it != range.second && tried < MAX_CANDIDATES; ++it, ++tried) {
+        size_t len = matchLength(it->second);
+        if (len > bestLen) {
+          bestLen = len;
+          bestSrc = it->second;
+        }
+      }
+    }
+    if (bestLen < MIN_COPY) {
+      pos++;
+      continue;
+    }
+    flushLiteral(ops, &target[literalStart], pos - literalStart);
+    ops.push_back(DELTA_OP_COPY);
+    put32(ops, bestSrc);
+    put16(ops, bestLen);
+    pos += bestLen;
+    nextSrc = bestSrc + bestLen;
+    literalStart = pos;
+  }
+  flushLiteral(ops, &target[literalStart], pos - literalStart);
+
+  // Round trip before anything is written
+  Bytes rebuilt;
+  VectorSink sink = { rebuilt };
+  DeltaApplier<VectorSink> applier(sink);
+  applier.begin(base.data(), base.size(), target.size());
+  if (!applier.feed(ops.data(), ops.size()) || !applier.complete() || rebuilt != target) {
+    fprintf(stderr, "internal error: delta does not rebuild the target\n");
+    return 1;
+  }
+
+  FILE *f = fopen(outPath, "wb");
+  if (!f || fwrite(&header, sizeof(header), 1, f) != 1 || fwrite(ops.data(), 1, ops.size(), f) != ops.size()) {
+    perror(outPath);
+    return 1;
+  }
+  fclose(f);
+  printf("target %zu bytes, delta %zu bytes (%.1f%%)\n", target.size(), sizeof(header) + ops.size(),
+         100.0 * (sizeof(header) + ops.size()) / target.size());
+  return 0;
+}
+
+static int push(ParkingLink &link, const char *deltaPath) {
+  Bytes delta;
+  if (!readFile(deltaPath, delta) || delta.size() < sizeof(DeltaHeader)) {
+    fprintf(stderr, "%s: not a delta\n", deltaPath);
+    return 1;
+  }
+  DeltaHeader header;
+  memcpy(&header, delta.data(), sizeof(header));
+  if (header.magic != DELTA_MAGIC) {
+    fprintf(stderr, "%s: not a delta\n", deltaPath);
+    return 1;
+  }
+
+  double start = nowMs();
+  int status = link.request(MSG_OTA_BEGIN, &header, sizeof(header), 3000);   // Controller hashes its image first
+  if (status != ACK_OK) {
+    fprintf(stderr, status == ACK_BAD_ARGUMENT ? "delta was built for a different base image\n"
+                                               : "controller refused the update (%d)\n", status);
+    return 1;
+  }
+
+  uint8_t payload[PROTO_MAX_PAYLOAD];
+  for (size_t off = sizeof(header); off < delta.size();) {
+    size_t len = delta.size() - off < CHUNK_BYTES ? delta.size() - off : CHUNK_BYTES;
+    OtaData chunk = { (uint32_t)(off - sizeof(header)) };
+    memcpy(payload, &chunk, sizeof(chunk));
+    memcpy(payload + sizeof(chunk), &delta[off], len);
+    int tries = 0;
+    while ((status = link.request(MSG_OTA_DATA, payload, sizeof(chunk) + len)) < 0 && ++tries < CHUNK_RETRIES) {}
+    if (status != ACK_OK) {
+      fprintf(stderr, "chunk at %zu failed (%d)\n", off, status);
+      return 1;
+    }
+    off += len;
+    fprintf(stderr, "\r%zu / %zu bytes", off, delta.size());
+  }
+  fprintf(stderr, "\n");
+
+  if ((status = link.request(MSG_OTA_END, nullptr, 0, 3000)) != ACK_OK) {
+    fprintf(stderr, "rebuilt image failed verification (%d)\n", status);
+    return 1;
+  }
+  double transferred = nowMs();
+
+  if ((status = link.request(MSG_OTA_ACTIVATE, nullptr, 0)) != ACK_OK) {
+    fprintf(stderr, "activation refused (%d)\n", status);
+    return 1;
+  }
+  double activated = nowMs();
+  Frame frame;
+  while (!link.receive(frame, 30000) || frame.type != MSG_TELEMETRY) {
+    if (nowMs() - activated > 30000) {
+      fprintf(stderr, "controller did not come back\n");
+      return 1;
+    }
+  }
+  printf("sent %zu bytes for a %u byte image in %.0f ms; unreachable for %.0f ms\n",
+         delta.size(), header.targetLength, transferred - start, nowMs() - activated);
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  if (argc == 5 && !strcmp(argv[1], "diff")) return diff(argv[2], argv[3], argv[4]);
+  if (argc == 4 && !strcmp(argv[1], "push")) {
+    const char *baudEnv = getenv("PARKCTL_BAUD");
+    ParkingLink link;
+    if (!link.open(argv[2], baudEnv ? strtoul(baudEnv, nullptr, 10) : 1000000)) {
+      perror(argv[2]);
+      return 1;
+    }
+    return push(link, argv[3]);
+  }
+  fprintf(stderr, "usage: %s diff <base.bin> <target.bin> <out.delta>\n"
+                  "       %s push <device> <update.delta>\n", argv[0], argv[0]);
+  return 2;
+}
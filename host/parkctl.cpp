@@ -0,0 +1,180 @@
+/**
+ * parkctl – command-line front end for the controller's binary serial link.
+ *
+ *   parkctl <device> watch                      Print streamed telemetry
+ *   parkctl <device> journal [fromSeq]          Dump the event journal
+ *   parkctl <device> open | close | ping        Send a command
+ *   parkctl <device> config <key> <index> <value>
+ *   parkctl <device> hist loop|cloud|remote [reset]  Print a latency histogram
+ *
+ * Set PARKCTL_BAUD to override the default 1 Mbaud.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "parking_link.h"
+
+static const char *eventName(uint8_t type) {
+  switch (type) {
+    case EVT_BOOT: return "boot";
+    case EVT_OCCUPANCY: return "occupancy";
+    case EVT_ACCESS_GRANTED: return "access-granted";
+    case EVT_ACCESS_DENIED: return "access-denied";
+    case EVT_GATE_OPEN: return "gate-open";
+    case EVT_GATE_CLOSE: return "gate-close";
+    case EVT_PRICE_TIER: return "price-tier";
+    case EVT_CONFIG: return "config";
+    case EVT_REMOTE_REJECTED: return "remote-rejected";
+    case EVT_LINK: return "link";
+    case EVT_TIME_SYNC: return "time-sync";
+    case EVT_OTA: return "ota";
+    case EVT_PASSAGE: return "passage";
+    case EVT_SENSOR: return "sensor";
+    case EVT_SESSION: return "session";
+    default: return "?";
+  }
+}
+
+/**
+ * Formats a journal stamp as UTC, or as boot-relative time before the first sync.
+ */
+static const char *formatStamp(uint32_t stamp, char *out, size_t size) {
+  if (stamp & STAMP_UNSYNCED) {
+    snprintf(out, size, "boot+%u ms", (unsigned)(stamp & ~STAMP_UNSYNCED));
+    return out;
+  }
+  time_t seconds = JOURNAL_EPOCH_UNIX + stamp / STAMP_TICKS_PER_SEC;
+  tm utc;
+  gmtime_r(&seconds, &utc);
+  size_t n = strftime(out, size, "%Y-%m-%dT%H:%M:%S", &utc);
+  snprintf(out + n, size - n, ".%uZ", (unsigned)(stamp % STAMP_TICKS_PER_SEC));
+  return out;
+}
+
+static int watch(ParkingLink &link) {
+  Frame frame;
+  for (;;) {
+    if (!link.receive(frame, 5000)) {
+      fprintf(stderr, "no telemetry (decode errors: %u)\n", link.decodeErrors());
+      continue;
+    }
+    if (frame.type != MSG_TELEMETRY || frame.length < sizeof(TelemetryMsg)) continue;
+    TelemetryMsg msg;
+    memcpy(&msg, frame.payload, sizeof(msg));
+    static const char *linkNames[] = { "offline", "wifi", "online" };
+    printf("t=%u ms  available=%u/%u  tier=%u ($%u.%02u/h)  gate=%s  journal=%u  loop=%u/%u cyc  "
+           "link=%s/%d dBm/%u drops  dropped=%u/%u/%u/%u  overruns=%u  spots=",
+           msg.uptimeMs, msg.availableSpots, msg.totalSpots, msg.priceTier,
+           msg.priceCents / 100, msg.priceCents % 100, msg.gateOpen ? "open" : "closed",
+           msg.journalNextSeq, msg.loopCyclesAvg, msg.loopCyclesMax,
+           msg.linkState <= LINK_ONLINE ? linkNames[msg.linkState] : "?", msg.rssiDbm, msg.linkDrops,
+           msg.eventDrops[CHANNEL_OCCUPANCY], msg.eventDrops[CHANNEL_CARD], msg.eventDrops[CHANNEL_PASSAGE],
+           msg.eventDrops[CHANNEL_HEALTH], msg.fsrOverruns);
+    size_t bitmapBytes = (msg.totalSpots + 7) / 8;
+    const uint8_t *occupied = frame.payload + sizeof(msg), *unknown = occupied + bitmapBytes;
+    for (unsigned i = 0; i < msg.totalSpots && sizeof(msg) + 2 * bitmapBytes <= frame.length; i++) {
+      putchar(unknown[i / 8] & (1 << (i % 8)) ? '?' : occupied[i / 8] & (1 << (i % 8)) ? 'X' : 'O');
+    }
+    // Per-task deadline misses and worst-case run time, by priority
+    size_t off = sizeof(msg) + 2 * bitmapBytes;
+    if (msg.taskCount) printf("  tasks=");
+    for (unsigned i = 0; i < msg.taskCount && off + sizeof(TaskStats) <= frame.length; i++, off += sizeof(TaskStats)) {
+      TaskStats stats;
+      memcpy(&stats, frame.payload + off, sizeof(stats));
+      printf("%sp%u:%u/%uus", i ? " " : "", stats.priority, stats.deadlineMisses, stats.wcetUs);
+    }
+    putchar('\n');
+    fflush(stdout);
+  }
+}
+
+static int journal(ParkingLink &link, uint32_t fromSeq) {
+  if (!link.requestJournal(fromSeq)) return 1;
+  Frame frame;
+  while (link.receive(frame, 2000)) {
+    if (frame.type == MSG_JOURNAL_END) return 0;
+    if (frame.type != MSG_JOURNAL_DATA) continue;
+    for (size_t off = 0; off + sizeof(JournalRecord) <= frame.length; off += sizeof(JournalRecord)) {
+      JournalRecord rec;
+      memcpy(&rec, frame.payload + off, sizeof(rec));
+      char when[32];
+      printf("%10u  %-23s  %-15s arg=%u value=%u\n", rec.seq, formatStamp(rec.stamp, when, sizeof(when)),
+             eventName(rec.type), rec.arg, rec.value);
+    }
+  }
+  fprintf(stderr, "journal dump timed out\n");
+  return 1;
+}
+
+static int histogram(ParkingLink &link, const char *name, bool reset) {
+  uint8_t id;
+  if (!strcmp(name, "loop")) id = HIST_LOOP;
+  else if (!strcmp(name, "cloud")) id = HIST_CLOUD;
+  else if (!strcmp(name, "remote")) id = HIST_REMOTE;
+  else {
+    fprintf(stderr, "unknown histogram: %s\n", name);
+    return 2;
+  }
+  if (!link.requestHistogram(id, reset)) return 1;
+
+  Frame frame;
+  while (link.receive(frame, 1000)) {
+    if (frame.type != MSG_HISTOGRAM || frame.length != sizeof(HistogramMsg)) continue;
+    HistogramMsg msg;
+    memcpy(&msg, frame.payload, sizeof(msg));
+    if (msg.id != id) continue;
+    uint64_t total = 0;
+    for (unsigned i = 0; i < HISTOGRAM_BUCKETS; i++) total += msg.buckets[i];
+    for (unsigned i = 0; i < HISTOGRAM_BUCKETS; i++) {
+      if (!msg.buckets[i]) continue;
+      unsigned long lo = i ? 1UL << i : 0;
+      if (i + 1 < HISTOGRAM_BUCKETS) printf("%8lu - %-8lu us", lo, (1UL << (i + 1)) - 1);
+      else printf("%8lu +          us", lo);
+      printf("  %10u  %5.1f%%\n", msg.buckets[i], 100.0 * msg.buckets[i] / total);
+    }
+    printf("samples=%llu  max=%u us\n", (unsigned long long)total, msg.maxUs);
+    return 0;
+  }
+  fprintf(stderr, "no histogram reply\n");
+  return 1;
+}
+
+static int reportAck(int status) {
+  if (status < 0) {
+    fprintf(stderr, "no acknowledgement\n");
+    return 1;
+  }
+  if (status != ACK_OK) {
+    fprintf(stderr, "rejected (status %d)\n", status);
+    return 1;
+  }
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s <device> watch|journal [seq]|open|close|ping|config <key> <index> <value>|hist <name> [reset]\n", argv[0]);
+    return 2;
+  }
+  const char *baudEnv = getenv("PARKCTL_BAUD");
+  ParkingLink link;
+  if (!link.open(argv[1], baudEnv ? strtoul(baudEnv, nullptr, 10) : 1000000)) {
+    perror(argv[1]);
+    return 1;
+  }
+
+  const char *cmd = argv[2];
+  if (!strcmp(cmd, "watch")) return watch(link);
+  if (!strcmp(cmd, "journal")) return journal(link, argc > 3 ? strtoul(argv[3], nullptr, 10) : 0);
+  if (!strcmp(cmd, "open")) return reportAck(link.command(CMD_OPEN_GATE));
+  if (!strcmp(cmd, "close")) return reportAck(link.command(CMD_CLOSE_GATE));
+  if (!strcmp(cmd, "ping")) return reportAck(link.command(CMD_PING));
+  if (!strcmp(cmd, "config") && argc == 6) {
+    return reportAck(link.setConfig(atoi(argv[3]), atoi(argv[4]), atol(argv[5])));
+  }
+  if (!strcmp(cmd, "hist") && argc >= 4) return histogram(link, argv[3], argc > 4 && !strcmp(argv[4], "reset"));
+  fprintf(stderr, "unknown command: %s\n", cmd);
+  return 2;
+}
@@ -0,0 +1,139 @@
+#include "parking_link.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace {
+
+long long nowMs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+speed_t standardSpeed(unsigned long baud) {
+  switch (baud) {
+    case 9600: return B9600;
+    case 19200: return B19200;
+    case 38400: return B38400;
+    case 57600: return B57600;
+    case 115200: return B115200;
+    case 230400: return B230400;
+#ifdef B460800
+    case 460800: return B460800;
+#endif
+#ifdef B921600
+    case 921600: return B921600;
+#endif
+#ifdef B1000000
+    case 1000000: return B1000000;
+#endif
+    default: return 0;
+  }
+}
+
+}  // namespace
+
+bool ParkingLink::open(const char *device, unsigned long baud) {
+  close();
+  fd_ = ::open(device, O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if (fd_ < 0) return false;
+
+  speed_t speed = standardSpeed(baud);
+  termios tio;
+  if (!speed || tcgetattr(fd_, &tio) != 0) {
+    close();
+    return false;
+  }
+  cfmakeraw(&tio);
+  tio.c_cflag |= CLOCAL | CREAD;
+  tio.c_cc[VMIN] = 0;
+  tio.c_cc[VTIME] = 0;
+  cfsetispeed(&tio, speed);
+  cfsetospeed(&tio, speed);
+  if (tcsetattr(fd_, TCSANOW, &tio) != 0) {
+    close();
+    return false;
+  }
+
+  tcflush(fd_, TCIOFLUSH);
+  rxPos_ = rxLen_ = 0;
+  return true;
+}
+
+void ParkingLink::close() {
+  if (fd_ >= 0) ::close(fd_);
+  fd_ = -1;
+}
+
+int ParkingLink::send(uint8_t type, const void *payload, size_t len) {
+  if (fd_ < 0) return -1;
+  uint8_t seq = txSeq_++;
+  size_t n = buildFrame(type, seq, payload, len, txBuf_);
+  if (n == 0) return -1;
+
+  size_t off = 0;
+  while (off < n) {
+    ssize_t w = ::write(fd_, txBuf_ + off, n - off);
+    if (w > 0) {
+      off += w;
+    } else if (w < 0 && errno == EAGAIN) {
+      pollfd pfd = { fd_, POLLOUT, 0 };
+      poll(&pfd, 1, 100);
+    } else if (w < 0 && errno != EINTR) {
+      return -1;
+    }
+  }
+  return seq;
+}
+
+bool ParkingLink::receive(Frame &frame, int timeoutMs) {
+  if (fd_ < 0) return false;
+  long long deadline = nowMs() + timeoutMs;
+
+  for (;;) {
+    while (rxPos_ < rxLen_) {
+      if (decoder_.feed(rxBuf_[rxPos_++])) {
+        frame.type = decoder_.type();
+        frame.seq = decoder_.seq();
+        frame.payload = decoder_.payload();
+        frame.length = decoder_.length();
+        return true;
+      }
+    }
+
+    long long left = deadline - nowMs();
+    if (left <= 0) return false;
+    pollfd pfd = { fd_, POLLIN, 0 };
+    int r = poll(&pfd, 1, (int)left);
+    if (r < 0 && errno != EINTR) return false;
+    if (r <= 0) continue;
+
+    ssize_t n = ::read(fd_, rxBuf_, sizeof(rxBuf_));
+    if (n < 0 && errno != EAGAIN && errno != EINTR) return false;
+    rxPos_ = 0;
+    rxLen_ = n > 0 ? (size_t)n : 0;
+  }
+}
+
+int ParkingLink::request(uint8_t type, const void *payload, size_t len, int timeoutMs) {
+  int seq = send(type, payload, len);
+  if (seq < 0) return -1;
+
+  long long deadline = nowMs() + timeoutMs;
+  Frame frame;
+  for (long long left = timeoutMs; left > 0; left = deadline - nowMs()) {
+    if (!receive(frame, (int)left)) return -1;
+    if (frame.type == MSG_ACK && frame.seq == (uint8_t)seq && frame.length == sizeof(AckMsg)) {
+      AckMsg ack;
+      memcpy(&ack, frame.payload, sizeof(ack));
+      return ack.status;
+    }
+    // Telemetry and other unsolicited frames are dropped while waiting
+  }
+  return -1;
+}
@@ -0,0 +1,69 @@
+/**
+ * Host-side driver for the controller's binary serial protocol (see ../protocol.h).
+ *
+ * Opens a POSIX serial device in raw mode and exchanges COBS/CRC16 frames with the
+ * controller. Receive buffers are fixed-size members; nothing allocates after open().
+ *
+ * Build (with a tool such as parkctl.cpp):
+ *   g++ -std=c++17 -O2 -I.. -o parkctl parkctl.cpp parking_link.cpp
+ */
+#pragma once
+
+#include "protocol.h"
+
+struct Frame {
+  uint8_t type;
+  uint8_t seq;
+  const uint8_t *payload;     // Valid until the next receive()
+  size_t length;
+};
+
+class ParkingLink {
+ public:
+  ~ParkingLink() { close(); }
+
+  bool open(const char *device, unsigned long baud = 1000000);
+  void close();
+  bool isOpen() const { return fd_ >= 0; }
+
+  // Sends one message; returns the sequence number used, or -1 on error.
+  int send(uint8_t type, const void *payload, size_t len);
+
+  // Waits up to timeoutMs for the next valid frame.
+  bool receive(Frame &frame, int timeoutMs);
+
+  // Sends a request and waits for the MSG_ACK that echoes its sequence number.
+  // Returns the AckStatus, or -1 on timeout.
+  int request(uint8_t type, const void *payload, size_t len, int timeoutMs = 1000);
+
+  int command(uint8_t code, uint8_t arg = 0) {
+    CommandMsg msg = { code, arg };
+    return request(MSG_COMMAND, &msg, sizeof(msg));
+  }
+
+  int setConfig(uint8_t key, uint8_t index, int32_t value) {
+    ConfigSet msg = { key, index, value };
+    return request(MSG_CONFIG_SET, &msg, sizeof(msg));
+  }
+
+  bool requestJournal(uint32_t fromSeq) {
+    JournalReq msg = { fromSeq };
+    return send(MSG_JOURNAL_REQ, &msg, sizeof(msg)) >= 0;
+  }
+
+  bool requestHistogram(uint8_t id, bool reset) {
+    HistogramReq msg = { id, reset };
+    return send(MSG_HISTOGRAM_REQ, &msg, sizeof(msg)) >= 0;
+  }
+
+  uint32_t decodeErrors() const { return decoder_.errors(); }
+
+ private:
+  int fd_ = -1;
+  uint8_t txSeq_ = 0;
+  FrameDecoder decoder_;
+  uint8_t txBuf_[PROTO_MAX_FRAME];
+  uint8_t rxBuf_[4096];
+  size_t rxPos_ = 0;
+  size_t rxLen_ = 0;
+};
@@ -0,0 +1,129 @@
+/**
+ * remote_latency – measures remote gate commands end to end through a Blynk server.
+ *
+ *   remote_latency <device> <server> <port> <auth-token> <operator-secret> [trials]
+ *
+ * Each trial writes "<code> open" to V2 through the server's HTTP API, then watches
+ * the controller's serial telemetry until the gate reports open, and closes it the
+ * same way. Point <server> at a local Blynk server (or any stand-in that relays the
+ * HTTP update to the device) to keep Internet jitter out of the numbers. The
+ * controller's own receipt-to-servo histogram (parkctl hist remote) splits off the
+ * on-target share.
+ *
+ * Telemetry is switched to TRIAL_TELEMETRY_MS for the run and restored afterwards.
+ *
+ * Build: g++ -std=c++17 -O2 -I.. -o remote_latency remote_latency.cpp parking_link.cpp
+ */
+#include <netdb.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "parking_link.h"
+
+#define TRIAL_TELEMETRY_MS    5               // Resolution of the gate-state observation
+#define TRIAL_TIMEOUT_MS   3000
+#define DEFAULT_TELEMETRY_MS 250
+
+static double nowMs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+/**
+ * Sends one HTTP update of V2 and waits for the server's reply.
+ */
+static bool writeV2(const char *server, const char *port, const char *token, const char *code, const char *verb) {
+  addrinfo hints = {}, *res = nullptr;
+  hints.ai_socktype = SOCK_STREAM;
+  if (getaddrinfo(server, port, &hints, &res) != 0) return false;
+  int fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+  bool ok = fd >= 0 && connect(fd, res->ai_addr, res->ai_addrlen) == 0;
+  freeaddrinfo(res);
+
+  if (ok) {
+    char request[512];
+    int n = snprintf(request, sizeof(request),
+                     "GET /external/api/update?token=%s&V2=%s%%20%s HTTP/1.1\r\n"
+                     "Host: %s\r\nConnection: close\r\n\r\n",
+                     token, code, verb, server);
+    ok = write(fd, request, n) == n;
+    char reply[256];
+    ok = ok && read(fd, reply, sizeof(reply)) > 0 && !strncmp(reply, "HTTP/1.1 200", 12);
+  }
+  if (fd >= 0) close(fd);
+  return ok;
+}
+
+/**
+ * Waits until telemetry reports the wanted gate state; returns false on timeout.
+ */
+static bool waitGate(ParkingLink &link, bool open, double deadlineMs) {
+  Frame frame;
+  while (nowMs() < deadlineMs) {
+    if (!link.receive(frame, 100)) continue;
+    if (frame.type != MSG_TELEMETRY || frame.length < sizeof(TelemetryMsg)) continue;
+    TelemetryMsg msg;
+    memcpy(&msg, frame.payload, sizeof(msg));
+    if ((bool)msg.gateOpen == open) return true;
+  }
+  return false;
+}
+
+static int compareDouble(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return x < y ? -1 : x > y;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 6) {
+    fprintf(stderr, "usage: %s <device> <server> <port> <auth-token> <operator-secret> [trials]\n", argv[0]);
+    return 2;
+  }
+  int trials = argc > 6 ? atoi(argv[6]) : 20;
+  if (trials < 1) trials = 1;
+
+  const char *baudEnv = getenv("PARKCTL_BAUD");
+  ParkingLink link;
+  if (!link.open(argv[1], baudEnv ? strtoul(baudEnv, nullptr, 10) : 1000000)) {
+    perror(argv[1]);
+    return 1;
+  }
+  if (link.setConfig(CFG_TELEMETRY_MS, 0, TRIAL_TELEMETRY_MS) != ACK_OK) {
+    fprintf(stderr, "controller did not accept the telemetry period\n");
+    return 1;
+  }
+
+  double *samples = new double[trials];
+  int done = 0;
+  for (int t = 0; t < trials; t++) {
+    double start = nowMs();
+    if (!writeV2(argv[2], argv[3], argv[4], argv[5], "open")) {
+      fprintf(stderr, "trial %d: server rejected the update\n", t);
+      break;
+    }
+    if (!waitGate(link, true, start + TRIAL_TIMEOUT_MS)) {
+      fprintf(stderr, "trial %d: gate did not open\n", t);
+      continue;
+    }
+    samples[done++] = nowMs() - start;
+
+    writeV2(argv[2], argv[3], argv[4], argv[5], "close");
+    waitGate(link, false, nowMs() + TRIAL_TIMEOUT_MS);
+  }
+  link.setConfig(CFG_TELEMETRY_MS, 0, DEFAULT_TELEMETRY_MS);
+
+  if (done == 0) {
+    delete[] samples;
+    return 1;
+  }
+  qsort(samples, done, sizeof(double), compareDouble);
+  printf("trials=%d  min=%.1f  p50=%.1f  p90=%.1f  max=%.1f ms (±%d ms telemetry resolution)\n",
+         done, samples[0], samples[done / 2], samples[done * 9 / 10], samples[done - 1], TRIAL_TELEMETRY_MS);
+  delete[] samples;
+  return 0;
+}
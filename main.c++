@@ -6,19 +6,31 @@
  *  - Controls a servo-driven gate for vehicle entry.
  *  - Uses an ultrasonic sensor to detect vehicle passage and automatically close the gate.
  *  - Monitors 3 parking spots using force-sensitive resistors (FSRs).
- *  - Displays system status and spot availability on an SSD1306 OLED display.
+ *  - Displays system status and spot availability on an SSD1306/SH1106 OLED (oled_panel.h).
  *  - Connects directly to WiFi using WiFiS3 and updates parking availability in real time via Blynk Cloud.
+ *  - Drives a red/green indicator LED per spot from the occupancy bitmap via 74HC595 shift registers.
+ *  - Derives an hourly price tier from current and forecast occupancy and publishes it.
+ *  - Shows a per-session QR code (payment / status link) on the OLED after access is granted.
+ *  - Services the Blynk connection from its own budgeted task with coalesced writes,
+ *    reconnecting in the background with jittered exponential backoff.
+ *  - Synchronizes a wall clock over SNTP for journal timestamps.
+ *  - Accepts delta firmware updates over the serial link (ota_delta.h, ota_flash.h).
+ *  - Keeps an in-RAM event journal and speaks a framed binary protocol (protocol.h) over
+ *    Serial for telemetry, journal dumps, configuration and commands.
  *
  * Hardware Connections:
  *  - MFRC522 RFID      : SS → pin 10, RST → pin 9, SPI interface
  *  - Servo Gate        : Signal → pin 3
  *  - Ultrasonic Sensor : TRIG → pin 7, ECHO → pin 8
  *  - FSR Sensors       : A0, A1, A2
- *  - SSD1306 OLED      : I2C SDA → A4, SCL → A5
+ *  - Spot LEDs         : 74HC595 chain, DATA → MOSI, CLK → SCK, LATCH → pin 6
+ *  - OLED (SSD1306/SH1106): I2C SDA → A4, SCL → A5
  *
  * Blynk:
  *  - Template ID: TMPL2JrlKDUrB
  *  - Virtual Pin: V0 (Available parking spots)
+ *  - Virtual Pin: V1 (Current hourly rate, cents)
+ *  - Virtual Pin: V2 (Remote command: "<code> open|close|config <key> <index> <value>")
  *
  * Authors: Jeriel Dones Aguayo, Abdiel Gomez Alverio
  * Date: April 2025
@@ -34,14 +46,28 @@
  #include <BlynkSimpleWifi.h>
  #include <Wire.h>                    // I2C communication (OLED)
  #include <Adafruit_GFX.h>           // Graphics library for OLED
- #include <Adafruit_SSD1306.h>       // OLED driver library
+ #include "oled_panel.h"             // Compile-time specialized OLED driver
+ #include "qr_code.h"                // Fixed-size QR encoder
  #include <MFRC522.h>                // RFID reader library
  #include <Servo.h>                  // Servo motor control
+ #include "protocol.h"               // Binary serial framing shared with host tools
+ #include "ota_delta.h"              // Delta format + streaming SHA-256
+ #include "ota_flash.h"              // Staging slot in code flash
+ #include "coro.h"                   // Protothreads for sequential flows
+ #include "event_bus.h"              // Compile-time wired event channels
+ #include "sample_blocks.h"          // Double-buffered sensor sample blocks
  
  // —— WiFi Credentials ——
  char ssid[] = "WiFi";
  char pass[] = "1234";
  
+ // —— Remote Operator Secret ——
+ // Unique to each controller: 16 to 32 letters, digits, '-' or '_'. Pass it with
+ // -DREMOTE_SECRET=... or set it here. Left empty, remote commands are refused.
+ #ifndef REMOTE_SECRET
+ #define REMOTE_SECRET ""
+ #endif
+ 
  // —— Pin Definitions —— 
  #define SS_PIN         10           // RFID SS pin
  #define RST_PIN         9           // RFID reset pin
@@ -53,28 +79,378 @@
  #define FSR2_PIN        A1          // Parking spot 2 FSR
  #define FSR3_PIN        A2          // Parking spot 3 FSR
  #define FSR_THRESHOLD   500         // Threshold for FSR1 (custom for FSR2/3 below)
+ #define FSR_HYSTERESIS   20         // ADC counts a reading must pass a threshold by
+ #define FSR_SCAN_MS      20         // Period of one scan over all FSRs (blocking analogRead()s)
+ #define FSR_BLOCK_SCANS   2         // Scans averaged per occupancy decision (every 40 ms)
+ 
+ #define LED_LATCH_PIN    6          // 74HC595 storage clock (RCLK)
+ #define LED_SPI_HZ  8000000         // Shift clock for the LED chain
  
- #define SCREEN_WIDTH    128         // OLED width (pixels)
- #define SCREEN_HEIGHT    64         // OLED height (pixels)
- #define OLED_RESET      -1          // OLED reset pin (not used)
+ #define SERIAL_BAUD  1000000         // Binary link; text logs share the port
+ 
+ #define OLED_PANEL  SSD1306_128x64  // Or SSD1306_128x32 / SH1106_128x64
+ #define OLED_ADDRESS      0x3C      // OLED I2C address
  
  // —— Global Objects ——
- Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET);
+ typedef OledPanel<OLED_PANEL> Display;
+ typedef ScreenLayout<Display::HEIGHT> Layout;
+ Display display(Wire);              // OLED driver + framebuffer
  MFRC522 rfid(SS_PIN, RST_PIN);      // RFID reader object
  Servo gateServo;                    // Servo motor object
  
+ // —— Screen Layout ——
+ #define PRICE_X         82          // Rows come from ScreenLayout for the panel
+ 
+ // —— Static UI Layer ——
+ // Border and labels are rasterized once at boot; each refresh copies them into
+ // the framebuffer and draws only the dynamic fields on top.
+ #define DISPLAY_BENCHMARK  0              // 1: time full vs layered redraw at boot
+ 
+ uint8_t staticLayer[Display::BUFFER_SIZE];
+ int16_t availableValueX = 0;              // Where the dynamic fields start
+ 
+ // —— Display Animation ——
+ // The display task runs every frame but only redraws and pushes fields whose
+ // values changed; the capacity bar eases toward its target a few columns per frame.
+ #define ANIM_FRAME_MS     40        // Display task period (25 fps)
+ #define BANNER_MS       2000        // How long grant/deny banners stay up
+ 
+ int16_t barShownWidth = 0;          // Capacity bar width currently on the panel
+ uint16_t shownPriceCents = 0;       // Field values currently on the panel
+ int16_t shownPriceEnd = PRICE_X;    // ... and where the price text ends
+ int shownAvailable = -1;
+ bool bannerVisible = false;
+ unsigned long bannerShownAtMs = 0;
+ 
+ // —— Session QR Code ——
+ #define QR_URL_PREFIX  "https://park.example/s/"   // + 8 hex digits, within QR_MAX_PAYLOAD
+ #define QR_SHOW_MS     15000        // How long the code stays up after a grant
+ 
+ QrCode sessionQr;                   // Cached modules; re-encoded only for a new payload
+ bool qrVisible = false;
+ unsigned long qrShownAtMs = 0;
+ uint8_t qrPagesPushed = 0;          // animateDisplay() sends the code a page per frame
+ 
  // —— Parking Spot Management ——
  const int totalSpots = 3;
- int availableSpots = totalSpots;
+ const byte fsrPins[totalSpots]       = { FSR1_PIN, FSR2_PIN, FSR3_PIN };
+ int fsrThresholds[totalSpots]        = { FSR_THRESHOLD, 270, 400 };  // Crossing points, ± FSR_HYSTERESIS
+ typedef SampleBlocks<uint16_t, totalSpots, FSR_BLOCK_SCANS> FsrBlocks;
+ FsrBlocks fsrBlocks;                 // Scans waiting to be filtered, a block at a time
+ 
+ byte occupancyBits[(totalSpots + 7) / 8];   // Bit set = spot occupied
+ byte unknownBits[sizeof(occupancyBits)];    // Bit set = sensor unhealthy, state unknown
+ int16_t spotStatusX[totalSpots];          // OLED x of each spot's O/X/? marker
+ char shownSpotGlyphs[totalSpots];         // Markers currently on the panel
+ int availableSpots = totalSpots;          // Free spots with a healthy sensor
+ int unknownSpots = 0;
  bool gateOpen = false;
  
+ // —— Sensor Health ——
+ // Running statistics per FSR, updated once per block in fixed point at constant
+ // cost. A sensor that is not SENSOR_OK makes its spot unknown ('?'), counted
+ // neither as available nor as occupied until the condition clears.
+ #define FSR_LEVEL_SHIFT       9           // Level average: alpha = 1/512 (~20 s of blocks)
+ #define FSR_NOISE_SHIFT       7           // In-block variance average: alpha = 1/128 (~5 s)
+ #define FSR_NOISE_LIMIT     400           // Average variance (counts²) of a noisy sensor
+ #define FSR_FLAT_SPAN         2           // Counts a reading may wander and still be flat
+ #define FSR_RAIL_LOW          3           // Flat at or below: open (dead) FSR, or an empty spot
+ #define FSR_RAIL_HIGH      1020           // Flat at or above: shorted FSR
+ #define FSR_STUCK_MS   86400000UL         // Flat at a rail this long = stuck...
+ #define FSR_STUCK_PASSAGES  100           // ...and, at the low rail, this many cars through the gate meanwhile
+ #define FSR_DRIFT_MARGIN     40           // Level average this close to the threshold...
+ #define FSR_DRIFT_MS     600000UL         // ...for this long = drifting
+ 
+ struct SensorHealth {
+   int32_t levelQ8;                        // Average block level, Q8
+   int32_t noiseQ8;                        // Average in-block variance, Q8
+   uint16_t flatRef;                       // Level the flat band is centred on
+   unsigned long flatSinceMs;              // Last transition or move out of the band
+   uint32_t flatSincePassages;             // passageCount at that moment
+   unsigned long clearSinceMs;             // Average last clear of the threshold
+   uint8_t state;                          // SensorState
+   bool primed;
+ };
+ SensorHealth sensorHealth[totalSpots];
+ uint32_t passageCount = 0;                // Vehicles through the gate since boot
+ 
+ // —— Gate Sequence ——
+ #define GATE_SETTLE_MS      2000          // After opening, before watching for the car
+ #define GATE_POLL_MS         100          // Ultrasonic sampling while waiting
+ #define GATE_CLOSE_DELAY_MS 2500          // After the car passed, before closing
+ #define PASSAGE_DISTANCE_CM 11.0          // Echo this close = vehicle under the arm
+ #define ECHO_TIMEOUT_US    25000          // Longest echo waited for (~4 m of range)
+ 
+ Protothread gateThread;
+ uint8_t gateGrant = 0;                    // Bumped by every openGate()
+ uint8_t gateThreadGrant = 0;              // ... as of the flow's last start
+ 
+ // —— Spot Indicator LEDs ——
+ // Two outputs per spot (green = free, red = occupied, both off = unknown),
+ // four spots per 74HC595.
+ const int ledFrameBytes = (totalSpots + 3) / 4;
+ const byte ledNibbleLUT[16] = {           // 4 occupancy bits → 8 LED bits
+   0x55, 0x56, 0x59, 0x5A, 0x65, 0x66, 0x69, 0x6A,
+   0x95, 0x96, 0x99, 0x9A, 0xA5, 0xA6, 0xA9, 0xAA
+ };
+ 
+ byte ledFrame[ledFrameBytes];
+ byte ledShownBits[sizeof(occupancyBits)];   // Bitmap currently latched on the LEDs
+ byte ledShownUnknown[sizeof(occupancyBits)];
+ bool ledFrameValid = false;
+ 
+ // —— Occupancy Aggregates ——
+ // The trend is the net occupancy change over a sliding window of whole minutes,
+ // so a burst of changes stops counting once it has left the window.
+ #define FORECAST_HORIZON_MIN  15          // Look-ahead for the occupancy forecast (minutes)
+ #define TREND_WINDOW_MIN      15          // Minutes of history behind the trend
+ #define TREND_BUCKET_MS    60000UL        // One bucket per minute
+ 
+ int occupiedSpots = 0;
+ int forecastOccupied = 0;                 // Occupied spots expected FORECAST_HORIZON_MIN from now
+ int16_t trendBuckets[TREND_WINDOW_MIN];   // Net change per minute, ring
+ uint8_t trendBucket = 0;                  // Minute being filled
+ int trendWindowSum = 0;                   // Net change over the whole window
+ 
+ // —— Dynamic Pricing ——
+ #define PRICE_TIERS            4
+ #define TIER_HYSTERESIS_PCT   10          // Must fall this far below a tier's entry point to leave it
+ 
+ uint16_t tierPriceCents[PRICE_TIERS]       = { 200, 300, 450, 600 };  // Hourly rate per tier
+ const uint8_t  tierEnterPct[PRICE_TIERS]   = {   0,  50,  75,  95 };  // Forecast occupancy to enter
+ 
+ uint8_t priceTier = 0;
+ int tierLowerBound = 0;                   // Forecast below this drops a tier
+ int tierUpperBound = 0;                   // Forecast at or above this raises a tier
+ 
+ // —— Event Journal ——
+ #define JOURNAL_CAPACITY     400          // Records kept in RAM; the oldest are overwritten
+ 
+ JournalRecord journal[JOURNAL_CAPACITY];
+ uint32_t journalNextSeq = 0;
+ uint32_t journalLastStamp = 0;            // Keeps synced stamps monotonic across corrections
+ 
+ // —— Time Sync ——
+ // SNTP over WiFiUDP, one request in flight, polled from a task. The wall clock is
+ // modelled as the last sync point plus elapsed millis() corrected by a drift
+ // estimate learned from successive syncs.
+ #define NTP_SERVER         "pool.ntp.org"   // Or a local stand-in
+ // #define NTP_SERVER_IP  192, 168, 1, 10   // Fixed address; no DNS lookup at all
+ #define NTP_PORT              123
+ #define NTP_LOCAL_PORT       2390
+ #define NTP_TIMEOUT_MS       1500
+ #define NTP_MAX_DELAY_MS      500         // Discard replies with a longer round trip
+ #define NTP_INTERVAL_MS    900000UL       // Between good syncs
+ #define NTP_RETRY_MS        10000         // After a failure
+ #define NTP_DRIFT_MIN_SPAN_MS 60000       // Sync spacing needed to update the drift estimate
+ #define NTP_MAX_DRIFT_PPM   20000L        // Clamp; the RA4M1 HOCO is specified to ±1%
+ 
+ WiFiUDP ntpUdp;
+ #ifdef NTP_SERVER_IP
+ IPAddress ntpAddress(NTP_SERVER_IP);
+ bool ntpResolved = true;
+ #else
+ IPAddress ntpAddress;
+ bool ntpResolved = false;                 // Looked up by the connection manager, see manageLink()
+ #endif
+ bool ntpListening = false;
+ bool ntpPending = false;
+ unsigned long ntpSentMs = 0;
+ unsigned long ntpSentUs = 0;
+ unsigned long nextNtpMs = 0;
+ 
+ bool clockSynced = false;
+ unsigned long syncMonoMs = 0;             // millis() at the last sync
+ uint64_t syncUnixMs = 0;                  // Wall clock at the last sync
+ long driftPpm = 0;                        // Local clock error; positive = millis() runs slow
+ 
+ // —— Serial Link ——
+ #define LINK_RX_BUDGET        64          // Max bytes decoded per pass
+ 
+ FrameDecoder linkDecoder;
+ uint8_t linkFrame[PROTO_MAX_FRAME];       // Encode scratch for outgoing frames
+ uint8_t linkTxSeq = 0;
+ unsigned long telemetryPeriodMs = 250;    // 0 = telemetry off
+ unsigned long lastTelemetryMs = 0;
+ bool journalDumpActive = false;
+ uint32_t journalDumpSeq = 0;              // Next record to send while dumping
+ 
+ // —— Bulk Journal Export ——
+ // Go-back-N over the serial link: up to exportWindow frames in flight, cumulative
+ // acks from the host, and a resend from the last ack when progress stalls.
+ #define EXPORT_MAX_WINDOW     16          // Cap on frames in flight
+ #define EXPORT_RETRANSMIT_MS 200          // Resend from the last ack after this long without progress
+ 
+ uint32_t bootId = 0;                      // Random per boot; tells the host when seqs restarted
+ bool exportActive = false;
+ uint8_t exportWindow = 0;
+ uint32_t exportAckedSeq = 0;              // Host holds every record below this
+ uint32_t exportSendSeq = 0;               // Next record to transmit
+ uint32_t exportEndSeq = 0;                // Journal head when the export started
+ unsigned long exportProgressMs = 0;
+ 
+ // —— Firmware Update ——
+ // A delta against the running sketch is rebuilt chunk by chunk straight into the
+ // staging slot; only a verified image may be activated.
+ #define OTA_IDLE         0
+ #define OTA_RECEIVING    1
+ #define OTA_VERIFIED     2
+ #define OTA_HASHING      3                // Checking the base; BEGIN is acknowledged after
+ #define OTA_HASH_SLICE   4096             // Base bytes hashed per serviceLink() run (~4 ms)
+ #define ACK_DEFERRED     0xFF             // handleOtaFrame(): the answer comes later
+ 
+ OtaStaging otaStaging;
+ DeltaApplier<OtaStaging> otaApplier(otaStaging);
+ DeltaHeader otaHeader;
+ uint8_t otaState = OTA_IDLE;
+ uint32_t otaStreamOffset = 0;             // Op stream bytes applied so far
+ Sha256 otaBaseSha;
+ uint32_t otaBaseHashed = 0;               // Base bytes hashed so far
+ uint8_t otaBeginSeq = 0;                  // Link sequence of the BEGIN to answer
+ uint8_t otaBeginStatus = ACK_DEFERRED;    // Its answer, until sent; ACK_DEFERRED: none due
+ 
+ // —— Loop Profiling ——
+ // Cycle counts per loop() pass over the current telemetry window. Cortex-M cores
+ // with a DWT unit count exact CPU cycles; elsewhere micros() is scaled by F_CPU.
+ #ifndef F_CPU
+ #define F_CPU 48000000UL                  // UNO R4 (RA4M1) core clock
+ #endif
+ 
+ uint32_t loopPasses = 0;
+ uint64_t loopCyclesSum = 0;
+ uint32_t loopCyclesMax = 0;
+ 
+ // —— Latency Histograms ——
+ // Log2 buckets in microseconds, read out over the link with MSG_HISTOGRAM_REQ.
+ struct LatencyHistogram {
+   uint32_t buckets[HISTOGRAM_BUCKETS];
+   uint32_t maxUs;
+ };
+ 
+ LatencyHistogram histograms[HIST_COUNT];
+ 
+ // —— Cloud Servicing ——
+ // Blynk.run() runs as its own task. A call that overruns CLOUD_BUDGET_US doubles
+ // the task's back-off (up to CLOUD_MAX_BACKOFF_MS) so a slow network cannot stretch
+ // every pass; fast calls shrink it again. Virtual-pin writes are coalesced into
+ // dirty bits and flushed one per call, only while the stack keeps within budget.
+ #define CLOUD_PERIOD_MS        10         // Nominal servicing period
+ #define CLOUD_BUDGET_US      2000         // Blynk.run() cost considered healthy
+ #define CLOUD_MAX_BACKOFF_MS  640         // Longest stretch; keeps well inside the heartbeat
+ 
+ #define CLOUD_PIN_AVAILABLE  0x01         // V0 pending
+ #define CLOUD_PIN_PRICE      0x02         // V1 pending
+ #define CLOUD_PIN_ALL        0x03
+ #define CLOUD_PIN_REMOTE     0x04         // V2 to be blanked after a command
+ 
+ uint8_t cloudDirty = CLOUD_PIN_ALL;
+ unsigned long cloudBackoffMs = 0;
+ unsigned long lastCloudRunMs = 0;
+ 
+ // —— Connection Manager ——
+ // WiFi and Blynk are (re)connected by a state machine in the cloud task instead
+ // of Blynk's own retry loop. No step waits for the network: WiFi.begin() only
+ // hands the join to the modem (its timeout is zero, see setup()) and the join is
+ // polled with WiFi.status(); Blynk.connect(0) arms the login and Blynk.run()
+ // drives it one call per pass. The first of those calls still waits for the
+ // modem to open the TCP socket, so attempts only start while the gate is closed.
+ // Failed attempts back off exponentially with jitter so a fleet does not retry
+ // in step.
+ #define LINK_BACKOFF_MIN_MS       500
+ #define LINK_BACKOFF_MAX_MS     60000
+ #define LINK_CHECK_MS            1000     // WiFi status and RSSI poll while online
+ #define LINK_POLL_MS              100     // WiFi status poll while joining
+ #define WIFI_JOIN_TIMEOUT_MS    10000     // An attempt gives up on the join after this
+ #define CLOUD_CONNECT_TIMEOUT_MS 1500     // ... and on the Blynk login after this
+ 
+ LinkState linkState = LINK_OFFLINE;
+ unsigned long linkBackoffMs = LINK_BACKOFF_MIN_MS;
+ unsigned long linkNextAttemptMs = 0;
+ unsigned long lastLinkCheckMs = 0;
+ bool linkAttempting = false;
+ unsigned long linkAttemptMs = 0;          // Start of the attempt in progress
+ int8_t linkRssi = 0;                      // dBm, 0 = unknown
+ uint16_t linkDrops = 0;
+ 
+ // —— Remote Commands ——
+ // V2 writes are authenticated and parsed inside Blynk.run(), then queued as
+ // protocol messages; serviceRemote() applies them on the next pass. Only a few
+ // secrets are checked per attempt window, so guessing stays slow without a
+ // lockout that a stranger could use to keep operators out. Every write is
+ // blanked from V2 afterwards so the secret does not linger as the pin's value.
+ #define REMOTE_SECRET_MIN_LEN  16
+ #define REMOTE_SECRET_MAX_LEN  32
+ #define REMOTE_QUEUE_LEN        4
+ #define REMOTE_WINDOW_MS     2000         // Attempt window
+ #define REMOTE_WINDOW_CHECKS    4         // Secrets checked per window; later writes are refused unchecked
+ 
+ static_assert(sizeof(REMOTE_SECRET) == 1 || (sizeof(REMOTE_SECRET) - 1 >= REMOTE_SECRET_MIN_LEN &&
+                                              sizeof(REMOTE_SECRET) - 1 <= REMOTE_SECRET_MAX_LEN),
+               "REMOTE_SECRET must be 16 to 32 characters");
+ 
+ struct RemoteCommand {
+   uint8_t type;                           // MSG_COMMAND or MSG_CONFIG_SET
+   CommandMsg cmd;
+   ConfigSet cfg;
+   unsigned long receivedUs;
+ };
+ 
+ RemoteCommand remoteQueue[REMOTE_QUEUE_LEN];
+ uint8_t remoteHead = 0;                   // Next command to apply
+ uint8_t remoteCount = 0;
+ unsigned long remoteWindowStartMs = 0;
+ uint8_t remoteChecks = 0;                 // Secrets checked in the current window
+ 
+ // —— Events ——
+ // Producers publish into EventChannels wired after setup(); dispatchEvents()
+ // delivers them to their subscribers once per pass.
+ #define EVENT_BENCHMARK  0                // 1: time bus dispatch against direct calls at boot
+ 
+ struct OccupancyChanged {
+   uint8_t spot;
+   bool occupied;
+ };
+ 
+ struct CardRead {
+   uint16_t uidTag;                        // First two UID bytes
+   bool authorized;
+ };
+ 
+ struct PassageDetected {
+   unsigned long atMs;
+ };
+ 
+ struct SensorHealthChanged {
+   uint8_t spot;
+   uint8_t state;                      // SensorState
+ };
+ 
+ // —— Cooperative Scheduler ——
+ // Tasks must return without blocking and are never preempted. Each pass runs the
+ // due tasks in priority order (0 = most urgent). A task is released at the start
+ // of every pass (periodMs 0) or once per period, and misses its deadline when it
+ // finishes more than deadlineMs after that release.
+ struct Task {
+   void (*run)();
+   unsigned long periodMs;             // 0 = every pass
+   unsigned long deadlineMs;
+   uint8_t priority;
+   unsigned long releaseUs = 0;        // Current or next release
+   uint32_t wcetUs = 0;                // Longest single run since boot
+   uint16_t misses = 0;                // Deadline misses since boot (saturating)
+ };
+ 
  void setup() {
-   Serial.begin(9600);
+   Serial.begin(SERIAL_BAUD);
+   journalAppend(EVT_BOOT, 0, 0);
+   startCycleCounter();
  
-   // Initialize Blynk and connect to WiFi
-   Serial.println(F("Connecting to WiFi..."));
-   Blynk.begin(BLYNK_AUTH_TOKEN, ssid, pass);
-   Serial.println(F("Connected to Blynk"));
+   // Blynk connects later from the cloud task; seed its retry jitter per board.
+   // WiFi.begin() returns once the modem has the credentials; manageLink() polls.
+   WiFi.setTimeout(0);
+   Blynk.config(BLYNK_AUTH_TOKEN);
+   randomSeed(micros() ^ analogRead(A3));   // A3 floats
+   while (bootId == 0) bootId = ((uint32_t)random(0x10000) << 16) | (uint32_t)random(0x10000);
  
    // RFID setup
    SPI.begin();                      // Start SPI bus
@@ -89,90 +465,826 @@
    pinMode(TRIG_PIN, OUTPUT);
    pinMode(ECHO_PIN, INPUT);
  
+   // LED chain latch idles high; show the empty lot until occupancy events arrive
+   pinMode(LED_LATCH_PIN, OUTPUT);
+   digitalWrite(LED_LATCH_PIN, HIGH);
+   updateSpotLeds();
+ 
+   // Pricing starts at the base tier with bounds derived from an empty lot
+   updatePriceTier();
+ 
    // OLED initialization
-   if (!display.begin(SSD1306_SWITCHCAPVCC, 0x3C)) {
-     Serial.println(F("SSD1306 allocation failed"));
+   if (!display.begin(OLED_ADDRESS)) {
+     Serial.println(F("OLED not responding"));
      while (true);                   // Stop if OLED fails
    }
+   display.setTextSize(1);
+   display.setTextColor(OLED_WHITE);
+   display.setCursor(Layout::textX, Layout::titleY);
+   display.print(F("Smart Parking"));
    display.display();                // Show splash screen
    delay(2000);
-   display.clearDisplay();
+   buildStaticLayer();
+ #if DISPLAY_BENCHMARK
+   benchmarkDisplay();
+ #endif
+ #if EVENT_BENCHMARK
+   benchmarkEventBus();
+ #endif
+   redrawScreen();
+   startScheduler();
  }
  
+ // Channel wiring and the task table live after setup() so the auto-generated
+ // prototypes precede them. Subscribers run in the order listed.
+ EventChannel<OccupancyChanged, 8, journalOccupancy, updatePricing, refreshSpotOutputs> occupancyEvents;
+ EventChannel<CardRead, 4, journalCard, admitOrReject> cardEvents;
+ EventChannel<PassageDetected, 2, journalPassage, countPassage> passageEvents;
+ EventChannel<SensorHealthChanged, 4, journalSensorHealth, applySensorHealth> healthEvents;
+ #if EVENT_BENCHMARK
+ EventChannel<OccupancyChanged, 16, countBenchEvent> benchEvents;
+ #endif
+ 
+ // Control tasks are ranked by what a late run costs: a waiting driver or a car
+ // under the arm first, then occupancy. The remaining periodic tasks follow
+ // rate-monotonically (shorter period first), except the cloud, whose 10 ms period
+ // is a polling rate for a best-effort sync rather than a deadline.
+ Task tasks[] = {
+   // run            period           deadline       priority
+   { pollRfid,       0,               50,            0 },
+   { serviceGate,    0,               50,            1 },
+   { readSpots,      FSR_SCAN_MS,     FSR_SCAN_MS,   2 },
+   { dispatchEvents, 0,               100,           3 },
+   { serviceRemote,  0,               100,           4 },
+   { serviceLink,    0,               100,           5 },
+   { animateDisplay, ANIM_FRAME_MS,   ANIM_FRAME_MS, 6 },
+   { syncClock,      100,             100,           7 },
+   { publishStatus,  500,             500,           8 },
+   { advanceTrend,   TREND_BUCKET_MS, 1000,          9 },
+   { serviceCloud,   CLOUD_PERIOD_MS, 1000,          10 },
+ };
+ #define TASK_COUNT  (sizeof(tasks) / sizeof(tasks[0]))
+ 
  void loop() {
-   Blynk.run();                      // Handle Blynk communication
+   uint32_t passStart = cycleCount();
+ 
+   unsigned long passUs = micros();
+   for (Task &task : tasks) {
+     unsigned long releaseUs = task.periodMs ? task.releaseUs : passUs;
+     unsigned long startUs = micros();
+     if ((long)(startUs - releaseUs) < 0) continue;
+     task.run();
+     unsigned long endUs = micros();
+     if (endUs - startUs > task.wcetUs) task.wcetUs = endUs - startUs;
+     if (endUs - releaseUs > task.deadlineMs * 1000UL && task.misses < 0xFFFF) task.misses++;
+     if (task.periodMs) {
+       task.releaseUs += task.periodMs * 1000UL;
+       // A whole period behind: drop the missed releases instead of running in a burst
+       if ((long)(endUs - task.releaseUs) >= 0) task.releaseUs = endUs;
+     }
+   }
  
-   // ——— 1) Read FSRs and Count Available Spots ——— 
-   int fsr1 = analogRead(FSR1_PIN);
-   int fsr2 = analogRead(FSR2_PIN);
-   int fsr3 = analogRead(FSR3_PIN);
+   uint32_t cycles = cycleCount() - passStart;
+   loopPasses++;
+   loopCyclesSum += cycles;
+   if (cycles > loopCyclesMax) loopCyclesMax = cycles;
+   recordLatency(histograms[HIST_LOOP], cycles / (F_CPU / 1000000UL));
+ }
+ 
+ /**
+  * 1) Scans every FSR into the current block; each completed block goes to
+  *    filterSpots() as a whole.
+  */
+ void readSpots() {
+   uint16_t *scan = fsrBlocks.frame();
+   for (int i = 0; i < totalSpots; i++) scan[i] = analogRead(fsrPins[i]);
+   if (fsrBlocks.commit()) {
+     filterSpots(*fsrBlocks.ready());
+     fsrBlocks.release();
+   }
+ }
  
-   bool spot1Free = fsr1 < FSR_THRESHOLD;
-   bool spot2Free = fsr2 < 270;
-   bool spot3Free = fsr3 < 400;
+ /**
+  * Averages each spot over a block, updates its sensor health and acts only on
+  * threshold crossings: a free spot turns occupied above threshold +
+  * FSR_HYSTERESIS and back below threshold - FSR_HYSTERESIS. Averages inside the
+  * band cost a compare and nothing else.
+  */
+ void filterSpots(const FsrBlocks::Block &block) {
+   unsigned long now = millis();
+   for (int i = 0; i < totalSpots; i++) {
+     uint32_t sum = 0, sumSquares = 0;
+     for (int scan = 0; scan < FSR_BLOCK_SCANS; scan++) {
+       uint32_t sample = block[scan][i];
+       sum += sample;
+       sumSquares += sample * sample;
+     }
+     int level = sum / FSR_BLOCK_SCANS;
+     uint32_t variance = (sumSquares - sum * sum / FSR_BLOCK_SCANS) / (FSR_BLOCK_SCANS - 1);   // Unbiased
+     setSensorState(i, assessSensor(i, level, variance, now));
  
-   availableSpots = 0;
-   if (spot1Free) availableSpots++;
-   if (spot2Free) availableSpots++;
-   if (spot3Free) availableSpots++;
+     bool occupied = spotOccupied(i);
+     if (occupied ? level >= fsrThresholds[i] - FSR_HYSTERESIS
+                  : level < fsrThresholds[i] + FSR_HYSTERESIS) continue;
+     setSpotOccupied(i, !occupied);
+     if (spotUnknown(i)) continue;             // Tracked, but not reported until the sensor recovers
+     availableSpots += occupied ? 1 : -1;
+     occupancyEvents.publish({ (uint8_t)i, !occupied });
+   }
+ }
  
-   Serial.print("Available Spots: "); Serial.println(availableSpots);
+ /**
+  * Folds one block into a sensor's statistics and returns its SensorState. The
+  * checks, most severe first: flat at a rail for FSR_STUCK_MS (shorted, or dead
+  * while FSR_STUCK_PASSAGES cars came in; a free spot also rests near 0), average
+  * in-block variance over FSR_NOISE_LIMIT (loose or failing), and a level average
+  * within FSR_DRIFT_MARGIN of the threshold for FSR_DRIFT_MS (drifted).
+  */
+ uint8_t assessSensor(int spot, int level, uint32_t variance, unsigned long now) {
+   SensorHealth &h = sensorHealth[spot];
+   if (!h.primed) {
+     h.levelQ8 = (int32_t)level << 8;
+     h.flatRef = level;
+     h.flatSinceMs = h.clearSinceMs = now;
+     h.flatSincePassages = passageCount;
+     h.primed = true;
+   }
+   h.levelQ8 += (((int32_t)level << 8) - h.levelQ8) >> FSR_LEVEL_SHIFT;
+   h.noiseQ8 += ((int32_t)(variance << 8) - h.noiseQ8) >> FSR_NOISE_SHIFT;
  
-   // ——— 2) RFID Authentication ——— 
+   if (abs(level - h.flatRef) > FSR_FLAT_SPAN) {
+     h.flatRef = level;
+     h.flatSinceMs = now;
+     h.flatSincePassages = passageCount;
+   }
+   if (abs((int)(h.levelQ8 >> 8) - fsrThresholds[spot]) > FSR_DRIFT_MARGIN) h.clearSinceMs = now;
+ 
+   // A noisy sensor must settle to half the limit before it counts again
+   int32_t noiseLimit = h.state == SENSOR_NOISY ? FSR_NOISE_LIMIT / 2 : FSR_NOISE_LIMIT;
+   if (now - h.flatSinceMs >= FSR_STUCK_MS &&
+       (h.flatRef >= FSR_RAIL_HIGH ||
+        (h.flatRef <= FSR_RAIL_LOW && passageCount - h.flatSincePassages >= FSR_STUCK_PASSAGES))) {
+     return SENSOR_STUCK;
+   }
+   if (h.noiseQ8 > noiseLimit << 8) return SENSOR_NOISY;
+   if (now - h.clearSinceMs >= FSR_DRIFT_MS) return SENSOR_DRIFTING;
+   return SENSOR_OK;
+ }
+ 
+ /**
+  * Records a sensor's state; entering or leaving SENSOR_OK moves the spot into
+  * or out of the unknown set and the available count, and leaving the set
+  * publishes the spot's current occupancy.
+  */
+ void setSensorState(int spot, uint8_t state) {
+   SensorHealth &h = sensorHealth[spot];
+   if (state == h.state) return;
+   bool unknown = state != SENSOR_OK;
+   if (unknown != (h.state != SENSOR_OK)) {
+     unknownBits[spot >> 3] ^= 1 << (spot & 7);
+     unknownSpots += unknown ? 1 : -1;
+     if (!spotOccupied(spot)) availableSpots += unknown ? -1 : 1;
+     // Crossings while unknown were not reported; report where the spot stands now
+     if (!unknown) occupancyEvents.publish({ (uint8_t)spot, spotOccupied(spot) });
+   }
+   h.state = state;
+   healthEvents.publish({ (uint8_t)spot, state });
+ }
+ 
+ /**
+  * 2) RFID authentication.
+  */
+ void pollRfid() {
    if (rfid.PICC_IsNewCardPresent() && rfid.PICC_ReadCardSerial()) {
-     if (isAuthorized(rfid.uid.uidByte)) {
-       Serial.println(F("Access Granted – Opening Gate"));
-       gateServo.write(0);           // Open gate
-       gateOpen = true;
-       delay(2000);
-     } else {
-       Serial.println(F("Access Denied – UID not recognized"));
-     }
+     uint16_t uidTag = rfid.uid.uidByte[0] << 8 | rfid.uid.uidByte[1];
+     cardEvents.publish({ uidTag, isAuthorized(rfid.uid.uidByte) });
      rfid.PICC_HaltA();              // Stop reading the current tag
    }
+ }
  
-   // ——— 3) Auto-Close Gate After Vehicle Entry ——— 
-   if (gateOpen) {
-     float distance = readDistanceCM();
-     Serial.print(F("Distance: "));
-     Serial.print(distance);
-     Serial.println(F(" cm"));
-     if (distance <= 11.0) {
-       Serial.println(F("Vehicle passed – closing gate"));
-       delay(2500);
-       gateServo.write(90);          // Close gate
-       gateOpen = false;
+ /**
+  * Delivers queued events to their subscribers.
+  */
+ void dispatchEvents() {
+   occupancyEvents.dispatch();
+   cardEvents.dispatch();
+   passageEvents.dispatch();
+   healthEvents.dispatch();
+ }
+ 
+ // —— Event Subscribers ——
+ 
+ /**
+  * Journals a spot change.
+  */
+ void journalOccupancy(const OccupancyChanged &e) {
+   journalAppend(EVT_OCCUPANCY, e.spot, e.occupied);
+ }
+ 
+ /**
+  * Refreshes the forecast; pricing only reacts to occupancy changes that cross
+  * the current tier's bounds. Several changes from one scan arrive as several
+  * events, but the bitmap already holds the whole scan, so only the first acts.
+  */
+ void updatePricing(const OccupancyChanged &) {
+   repriceOccupancy();
+ }
+ 
+ /**
+  * Updates the spot LEDs and queues the new count for Blynk.
+  */
+ void refreshSpotOutputs(const OccupancyChanged &) {
+   cloudDirty |= CLOUD_PIN_AVAILABLE;
+   updateSpotLeds();
+ }
+ 
+ /**
+  * Logs and journals a sensor health change.
+  */
+ void journalSensorHealth(const SensorHealthChanged &e) {
+   static const char *const names[] = { "ok", "stuck", "noisy", "drifting" };
+   Serial.print(F("Spot ")); Serial.print(e.spot + 1);
+   Serial.print(F(" sensor ")); Serial.println(names[e.state]);
+   journalAppend(EVT_SENSOR, e.spot, e.state);
+ }
+ 
+ /**
+  * Re-prices and refreshes the outputs once a spot has become unknown or known.
+  */
+ void applySensorHealth(const SensorHealthChanged &) {
+   repriceOccupancy();
+   cloudDirty |= CLOUD_PIN_AVAILABLE;
+   updateSpotLeds();
+ }
+ 
+ /**
+  * Feeds the occupied count (unknown spots excluded) to the forecast and moves
+  * the tier if the forecast left its bounds.
+  */
+ void repriceOccupancy() {
+   int occupied = totalSpots - availableSpots - unknownSpots;
+   if (occupied == occupiedSpots) return;
+   updateOccupancyAggregates(occupied);
+   if (forecastOccupied < tierLowerBound || forecastOccupied >= tierUpperBound) {
+     updatePriceTier();
+   }
+ }
+ 
+ /**
+  * Journals a card read with its outcome.
+  */
+ void journalCard(const CardRead &e) {
+   journalAppend(e.authorized ? EVT_ACCESS_GRANTED : EVT_ACCESS_DENIED, 0, e.uidTag);
+ }
+ 
+ /**
+  * Opens the gate with a session QR for an authorized card, else shows a banner.
+  */
+ void admitOrReject(const CardRead &e) {
+   if (e.authorized) {
+     Serial.println(F("Access Granted – Opening Gate"));
+     openGate(0);
+     showSessionQr(e.uidTag);
+   } else {
+     Serial.println(F("Access Denied – UID not recognized"));
+     showBanner(F("ACCESS DENIED"));
+   }
+ }
+ 
+ /**
+  * Logs and journals a vehicle passing under the arm.
+  */
+ void journalPassage(const PassageDetected &) {
+   Serial.println(F("Vehicle passed – closing gate"));
+   journalAppend(EVT_PASSAGE, 0, 0);
+ }
+ 
+ /**
+  * Counts passages; cars coming in while a spot reads open-circuit flat are the
+  * evidence that its sensor, not the spot, is dead.
+  */
+ void countPassage(const PassageDetected &) {
+   passageCount++;
+ }
+ 
+ /**
+  * Gate flow for every open, whatever its source: settle, watch the ultrasonic
+  * sensor until the vehicle passes, wait, close. Starts over if the gate is
+  * closed by a command meanwhile, or if another open was granted since the flow
+  * started, so the gate stays up for the next car.
+  */
+ PT_THREAD(gateSequence(Protothread &pt)) {
+   PT_BEGIN(pt);
+   PT_WAIT_UNTIL(pt, gateOpen);
+   gateThreadGrant = gateGrant;
+   PT_SLEEP(pt, GATE_SETTLE_MS);
+ 
+   while (gateOpen && !vehicleUnderArm()) {
+     PT_SLEEP(pt, GATE_POLL_MS);
+   }
+   if (!gateOpen) PT_RESTART(pt);
+ 
+   passageEvents.publish({ millis() });
+   pt.timer = millis();
+   PT_WAIT_UNTIL(pt, gateGrant != gateThreadGrant || millis() - pt.timer >= GATE_CLOSE_DELAY_MS);
+   if (gateGrant != gateThreadGrant) PT_RESTART(pt);
+   if (gateOpen) closeGate();
+   PT_END(pt);
+ }
+ 
+ /**
+  * Takes one ultrasonic reading; true if a vehicle is under the arm. A missing
+  * echo is no reading, not a vehicle at 0 cm.
+  */
+ bool vehicleUnderArm() {
+   float distance = readDistanceCM();
+   if (distance < 0) {
+     Serial.println(F("Distance: no echo"));
+     return false;
+   }
+   Serial.print(F("Distance: "));
+   Serial.print(distance);
+   Serial.println(F(" cm"));
+   return distance <= PASSAGE_DISTANCE_CM;
+ }
+ 
+ /**
+  * 3) Auto-closes the gate after vehicle entry.
+  */
+ void serviceGate() {
+   gateSequence(gateThread);
+ }
+ 
+ /**
+  * 4) OLED display: expires timed overlays, redraws changed fields and steps the
+  * capacity bar, pushing only the columns each change touched.
+  */
+ void animateDisplay() {
+   unsigned long now = millis();
+   if (qrVisible) {
+     if (qrPagesPushed < Display::PAGES) {
+       display.displayRows(0, Display::WIDTH, qrPagesPushed * 8, 8);
+       qrPagesPushed++;
+       return;
      }
+     if (now - qrShownAtMs < QR_SHOW_MS) return;   // Frame already on the panel
+     qrVisible = false;
+     redrawScreen();
+     return;
    }
+   if (bannerVisible && now - bannerShownAtMs >= BANNER_MS) hideBanner();
  
-   // ——— 4) OLED Display ——— 
-   display.clearDisplay();
-   display.drawRect(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, SSD1306_WHITE);
+   if (!bannerVisible && tierPriceCents[priceTier] != shownPriceCents) {
+     shownPriceCents = tierPriceCents[priceTier];
+     int16_t end = blitPrice(PRICE_X, Layout::titleY, shownPriceCents);
+     if (end < shownPriceEnd) {                 // Clear a shrinking price
+       display.fillArea(end, Layout::titleY, shownPriceEnd - end, 8, OLED_BLACK);
+     }
+     display.displayRows(PRICE_X, max(end, shownPriceEnd), Layout::titleY, 8);
+     shownPriceEnd = end;
+   }
  
-   display.setTextSize(1);
-   display.setTextColor(SSD1306_WHITE);
+   if (availableSpots != shownAvailable) {
+     shownAvailable = availableSpots;
+     int16_t end = display.blitUInt(availableValueX, Layout::availableY, availableSpots);
+     end = display.blitGlyph(end, Layout::availableY, ' ');   // Clear a shrinking number
+     display.displayRows(availableValueX, end, Layout::availableY, 8);
+   }
+ 
+   for (int i = 0; i < totalSpots; i++) {
+     char glyph = spotGlyph(i);
+     if (glyph == shownSpotGlyphs[i]) continue;
+     shownSpotGlyphs[i] = glyph;
+     int16_t end = display.blitGlyph(spotStatusX[i], Layout::spotsY, glyph);
+     display.displayRows(spotStatusX[i], end, Layout::spotsY, 8);
+   }
+ 
+   // Ease-out: cover a quarter of the remaining distance per frame, at least one column
+   int16_t target = map(availableSpots, 0, totalSpots, 0, Display::WIDTH);
+   int16_t diff = target - barShownWidth;
+   if (diff != 0) {
+     int16_t step = diff / 4;
+     if (step == 0) step = diff > 0 ? 1 : -1;
+     int16_t from = barShownWidth, to = barShownWidth + step;
+     display.fillArea(min(from, to), Layout::barY, abs(step), Layout::barHeight, step > 0 ? OLED_WHITE : OLED_BLACK);
+     display.displayRows(min(from, to), max(from, to), Layout::barY, Layout::barHeight);
+     barShownWidth = to;
+   }
+ }
+ 
+ /**
+  * Rebuilds the whole frame from the static layer and pushes it.
+  */
+ void redrawScreen() {
+   memcpy(display.getBuffer(), staticLayer, sizeof(staticLayer));
+   drawDynamicFields();
+   shownPriceCents = tierPriceCents[priceTier];
+   shownAvailable = availableSpots;
+   for (int i = 0; i < totalSpots; i++) shownSpotGlyphs[i] = spotGlyph(i);
+   bannerVisible = false;
+   display.display();
+ }
  
-   display.setCursor(10, 5);
-   display.println(F("Insert ID"));
+ /**
+  * Shows an inverted banner over the title row for BANNER_MS.
+  */
+ void showBanner(const __FlashStringHelper *text) {
+   if (qrVisible) {
+     qrVisible = false;
+     redrawScreen();
+   }
+   display.fillArea(1, Layout::titleY, PRICE_X - 2, 8, OLED_WHITE);
+   display.setTextColor(OLED_BLACK);
+   display.setCursor(2, Layout::titleY);
+   display.print(text);
+   display.setTextColor(OLED_WHITE);
+   display.displayRows(1, PRICE_X - 1, Layout::titleY, 8);
+   bannerVisible = true;
+   bannerShownAtMs = millis();
+ }
  
-   display.setCursor(10, 20);
+ /**
+  * Restores the title row under a banner from the static layer.
+  */
+ void hideBanner() {
+   uint16_t row = (Layout::titleY >> 3) * Display::WIDTH;
+   memcpy(display.getBuffer() + row, staticLayer + row, Display::WIDTH);
+   shownPriceCents = tierPriceCents[priceTier];
+   shownPriceEnd = blitPrice(PRICE_X, Layout::titleY, shownPriceCents);
+   display.displayRows(0, Display::WIDTH, Layout::titleY, 8);
+   bannerVisible = false;
+ }
+ 
+ /**
+  * Draws the border and labels once and keeps a copy of the result.
+  */
+ void buildStaticLayer() {
+   display.clearDisplay();
+   if (Layout::border) display.drawRect(0, 0, Display::WIDTH, Display::HEIGHT, OLED_WHITE);
+ 
+   display.setCursor(Layout::textX, Layout::titleY);
+   display.print(F("Insert ID"));
+ 
+   display.setCursor(Layout::textX, Layout::availableY);
    display.print(F("Available: "));
-   display.println(availableSpots);
+   availableValueX = display.getCursorX();
+ 
+   display.setCursor(Layout::textX, Layout::spotsY);
+   for (int i = 0; i < totalSpots; i++) {
+     display.print(i == 0 ? F("S") : F(" S")); display.print(i + 1); display.print(F(": "));
+     spotStatusX[i] = display.getCursorX();
+     display.setCursor(spotStatusX[i] + GLYPH_ADVANCE, Layout::spotsY);   // Leave a cell for the marker
+   }
+ 
+   memcpy(staticLayer, display.getBuffer(), sizeof(staticLayer));
+ }
+ 
+ /**
+  * Draws the values that change between refreshes.
+  */
+ void drawDynamicFields() {
+   shownPriceEnd = blitPrice(PRICE_X, Layout::titleY, tierPriceCents[priceTier]);
+   display.blitUInt(availableValueX, Layout::availableY, availableSpots);
+ 
+   for (int i = 0; i < totalSpots; i++) {
+     display.blitGlyph(spotStatusX[i], Layout::spotsY, spotGlyph(i));
+   }
+ 
+   display.fillArea(0, Layout::barY, barShownWidth, Layout::barHeight, OLED_WHITE);
+ }
+ 
+ #if DISPLAY_BENCHMARK
+ /**
+  * Times rendering (excluding the I2C push) of the whole screen through
+  * Adafruit_GFX against the static-layer copy plus dynamic fields.
+  */
+ void benchmarkDisplay() {
+   const int rounds = 20;
+ 
+   uint32_t start = cycleCount();
+   for (int r = 0; r < rounds; r++) {
+     buildStaticLayer();
+     drawDynamicFields();
+   }
+   uint32_t fullCycles = (cycleCount() - start) / rounds;
+ 
+   start = cycleCount();
+   for (int r = 0; r < rounds; r++) {
+     memcpy(display.getBuffer(), staticLayer, sizeof(staticLayer));
+     drawDynamicFields();
+   }
+   uint32_t layeredCycles = (cycleCount() - start) / rounds;
+ 
+   // Dynamic text alone: Adafruit_GFX print vs the glyph blitter
+   start = cycleCount();
+   for (int r = 0; r < rounds; r++) {
+     display.setCursor(PRICE_X, Layout::titleY);
+     display.print('$'); display.print(tierPriceCents[priceTier] / 100); display.print('.');
+     display.print(tierPriceCents[priceTier] % 100);
+     display.setCursor(availableValueX, Layout::availableY);
+     display.print(availableSpots);
+     for (int i = 0; i < totalSpots; i++) {
+       display.setCursor(spotStatusX[i], Layout::spotsY);
+       display.print(spotGlyph(i));
+     }
+   }
+   uint32_t gfxTextCycles = (cycleCount() - start) / rounds;
+ 
+   start = cycleCount();
+   for (int r = 0; r < rounds; r++) {
+     blitPrice(PRICE_X, Layout::titleY, tierPriceCents[priceTier]);
+     display.blitUInt(availableValueX, Layout::availableY, availableSpots);
+     for (int i = 0; i < totalSpots; i++) {
+       display.blitGlyph(spotStatusX[i], Layout::spotsY, spotGlyph(i));
+     }
+   }
+   uint32_t blitTextCycles = (cycleCount() - start) / rounds;
+ 
+   Serial.print(F("Display render cycles – full: ")); Serial.print(fullCycles);
+   Serial.print(F(", layered: ")); Serial.println(layeredCycles);
+   Serial.print(F("Text render cycles – GFX: ")); Serial.print(gfxTextCycles);
+   Serial.print(F(", blitter: ")); Serial.println(blitTextCycles);
+ }
+ #endif
+ 
+ #if EVENT_BENCHMARK
+ volatile uint32_t benchEventSum = 0;
+ 
+ void countBenchEvent(const OccupancyChanged &e) {
+   benchEventSum += e.spot;
+ }
+ 
+ /**
+  * Times delivering an event straight to a subscriber against publishing it
+  * through a channel and dispatching in batches.
+  */
+ void benchmarkEventBus() {
+   const int rounds = 256;
+ 
+   uint32_t start = cycleCount();
+   for (int r = 0; r < rounds; r++) countBenchEvent({ (uint8_t)r, true });
+   uint32_t directCycles = cycleCount() - start;
+ 
+   start = cycleCount();
+   for (int r = 0; r < rounds; r++) {
+     benchEvents.publish({ (uint8_t)r, true });
+     if ((r & 15) == 15) benchEvents.dispatch();
+   }
+   uint32_t busCycles = cycleCount() - start;
+ 
+   Serial.print(F("Event cycles per event – direct: ")); Serial.print(directCycles / (float)rounds);
+   Serial.print(F(", bus: ")); Serial.println(busCycles / (float)rounds);
+ }
+ #endif
+ 
+ /**
+  * 5) Reports availability on the text log; Blynk gets it through serviceCloud().
+  */
+ void publishStatus() {
+   Serial.print("Available Spots: "); Serial.println(availableSpots);
+ }
+ 
+ /**
+  * 6) Runs the Blynk stack within its time budget and flushes one pending write.
+  */
+ void serviceCloud() {
+   unsigned long now = millis();
+   if (now - lastCloudRunMs < cloudBackoffMs) return;
+   lastCloudRunMs = now;
+   if (!manageLink(now)) return;
+ 
+   uint32_t start = cycleCount();
+   Blynk.run();
+   uint32_t us = (cycleCount() - start) / (F_CPU / 1000000UL);
+   recordLatency(histograms[HIST_CLOUD], us);
+ 
+   if (us > CLOUD_BUDGET_US) {
+     // The first step skips one period; the task's own period would be no back-off at all
+     cloudBackoffMs = cloudBackoffMs ? min(cloudBackoffMs * 2, (unsigned long)CLOUD_MAX_BACKOFF_MS) : 2 * CLOUD_PERIOD_MS;
+     return;                         // Writes wait until the stack keeps up again
+   }
+   cloudBackoffMs /= 2;
+ 
+   if (!cloudDirty || !Blynk.connected()) return;
+   if (cloudDirty & CLOUD_PIN_AVAILABLE) {
+     cloudDirty &= ~CLOUD_PIN_AVAILABLE;
+     Blynk.virtualWrite(V0, availableSpots);
+   } else if (cloudDirty & CLOUD_PIN_PRICE) {
+     cloudDirty &= ~CLOUD_PIN_PRICE;
+     Blynk.virtualWrite(V1, tierPriceCents[priceTier]);
+   } else if (cloudDirty & CLOUD_PIN_REMOTE) {
+     cloudDirty &= ~CLOUD_PIN_REMOTE;
+     Blynk.virtualWrite(V2, "");
+   }
+ }
+ 
+ /**
+  * Advances the connection state machine; returns true while Blynk is connected.
+  */
+ bool manageLink(unsigned long now) {
+   if (linkState == LINK_ONLINE) {
+     if (now - lastLinkCheckMs >= LINK_CHECK_MS) {
+       lastLinkCheckMs = now;
+       if (WiFi.status() != WL_CONNECTED) setLinkState(LINK_OFFLINE);
+       else linkRssi = WiFi.RSSI();
+       if (linkState == LINK_ONLINE && !ntpResolved && !gateOpen && (long)(now - nextNtpMs) >= 0) {
+         resolveNtpServer(now);
+       }
+     }
+     if (linkState == LINK_ONLINE && !Blynk.connected()) setLinkState(LINK_WIFI);
+     return linkState == LINK_ONLINE;
+   }
+ 
+   if (!linkAttempting) {
+     if ((long)(now - linkNextAttemptMs) < 0 || gateOpen) return false;
+     if (linkState == LINK_WIFI && WiFi.status() != WL_CONNECTED) {
+       setLinkState(LINK_OFFLINE);             // Lost while Blynk was backing off
+       return false;
+     }
+     linkAttempting = true;
+     linkAttemptMs = lastLinkCheckMs = now;
+     if (linkState == LINK_WIFI) {
+       if (!ntpResolved) resolveNtpServer(now);   // Once per join, while the gate is closed
+       Blynk.connect(0);
+     } else if (WiFi.status() != WL_CONNECTED) {
+       WiFi.begin(ssid, pass);
+     }
+     return false;
+   }
+ 
+   bool ok;
+   if (linkState == LINK_OFFLINE) {
+     if (now - lastLinkCheckMs < LINK_POLL_MS) return false;
+     lastLinkCheckMs = now;
+     ok = WiFi.status() == WL_CONNECTED;
+     if (ok) setLinkState(LINK_WIFI);            // Blynk gets its turn next call
+     else if (now - linkAttemptMs < WIFI_JOIN_TIMEOUT_MS) return false;
+   } else {
+     Blynk.run();
+     ok = Blynk.connected();
+     if (ok) setLinkState(LINK_ONLINE);
+     else if (now - linkAttemptMs < CLOUD_CONNECT_TIMEOUT_MS) return false;
+     else Blynk.disconnect();
+   }
+   linkAttempting = false;
+   if (ok) {
+     linkBackoffMs = LINK_BACKOFF_MIN_MS;
+     linkNextAttemptMs = millis();
+   } else {
+     // Equal jitter: wait between half and all of the current backoff
+     linkNextAttemptMs = millis() + random(linkBackoffMs / 2, linkBackoffMs + 1);
+     linkBackoffMs = min(linkBackoffMs * 2, (unsigned long)LINK_BACKOFF_MAX_MS);
+   }
+   return false;
+ }
  
-   display.setCursor(10, 35);
-   display.print(F("S1: ")); display.print(spot1Free ? "O" : "X");
-   display.print(F(" S2: ")); display.print(spot2Free ? "O" : "X");
-   display.print(F(" S3: ")); display.println(spot3Free ? "O" : "X");
+ /**
+  * Looks NTP_SERVER up for syncClock(). The lookup blocks, so only the connection
+  * manager makes it: after each join and, once online, again after a failure.
+  */
+ void resolveNtpServer(unsigned long now) {
+   ntpResolved = WiFi.hostByName(NTP_SERVER, ntpAddress) == 1;
+   if (!ntpResolved) nextNtpMs = now + NTP_RETRY_MS;
+ }
  
-   int barWidth = map(availableSpots, 0, totalSpots, 0, SCREEN_WIDTH);
-   display.fillRect(0, SCREEN_HEIGHT - 9, barWidth, 5, SSD1306_WHITE);
+ /**
+  * Records a connection state change, counting drops and refreshing the RSSI.
+  */
+ void setLinkState(LinkState state) {
+   if (state < linkState) {
+     linkDrops++;
+     if (state == LINK_WIFI) Blynk.disconnect();
+     linkBackoffMs = LINK_BACKOFF_MIN_MS;        // First retry soon after a drop
+     linkNextAttemptMs = millis();
+   }
+   linkState = state;
+   linkRssi = state == LINK_OFFLINE ? 0 : WiFi.RSSI();
+   lastLinkCheckMs = millis();
+   journalAppend(EVT_LINK, state, (uint16_t)(int16_t)linkRssi);
+   Serial.print(F("Link ")); Serial.print(state); Serial.print(F(", RSSI ")); Serial.println(linkRssi);
+ }
  
-   display.display();                // Push new display content
+ /**
+  * Republishes every pin after (re)connecting to Blynk.
+  */
+ BLYNK_CONNECTED() {
+   cloudDirty |= CLOUD_PIN_ALL;
+ }
  
-   // ——— 5) Send to Blynk ——— 
-   Blynk.virtualWrite(V0, availableSpots);
+ /**
+  * Remote command from the Blynk app or HTTP API. Runs inside Blynk.run(), so it
+  * only authenticates, parses and queues; nothing here touches the hardware.
+  */
+ BLYNK_WRITE(V2) {
+   cloudDirty |= CLOUD_PIN_REMOTE;
+   if (sizeof(REMOTE_SECRET) == 1) {
+     journalAppend(EVT_REMOTE_REJECTED, 5, 0);
+     return;
+   }
+   unsigned long now = millis();
+   if (now - remoteWindowStartMs >= REMOTE_WINDOW_MS) {
+     remoteWindowStartMs = now;
+     remoteChecks = 0;
+   }
+   if (remoteChecks == REMOTE_WINDOW_CHECKS) {
+     journalAppend(EVT_REMOTE_REJECTED, 3, 0);
+     return;
+   }
+   remoteChecks++;
+ 
+   // One character wider than any secret, so an overlong candidate cannot match
+   char code[REMOTE_SECRET_MAX_LEN + 2], verb[8];
+   long key = 0, index = 0, value = 0;
+   int fields = sscanf(param.asStr(), "%33s %7s %ld %ld %ld", code, verb, &key, &index, &value);
+   if (fields < 1 || !remoteCodeMatches(code)) {
+     journalAppend(EVT_REMOTE_REJECTED, 1, 0);
+     return;
+   }
  
-   delay(500);                       // Short delay before next loop
+   RemoteCommand rc;
+   rc.receivedUs = micros();
+   if (fields == 2 && !strcmp(verb, "open")) {
+     rc.type = MSG_COMMAND;
+     rc.cmd = { CMD_OPEN_GATE, 0 };
+   } else if (fields == 2 && !strcmp(verb, "close")) {
+     rc.type = MSG_COMMAND;
+     rc.cmd = { CMD_CLOSE_GATE, 0 };
+   } else if (fields == 5 && !strcmp(verb, "config")) {
+     rc.type = MSG_CONFIG_SET;
+     rc.cfg = { (uint8_t)key, (uint8_t)index, (int32_t)value };
+   } else {
+     journalAppend(EVT_REMOTE_REJECTED, 2, 0);
+     return;
+   }
+ 
+   if (remoteCount == REMOTE_QUEUE_LEN) {
+     journalAppend(EVT_REMOTE_REJECTED, 4, 0);
+     return;
+   }
+   remoteQueue[(remoteHead + remoteCount++) % REMOTE_QUEUE_LEN] = rc;
+ }
+ 
+ /**
+  * Compares a candidate against REMOTE_SECRET without an early exit, so response
+  * timing does not reveal how many leading characters were right.
+  */
+ bool remoteCodeMatches(const char *candidate) {
+   static const char secret[] = REMOTE_SECRET;
+   size_t len = strlen(candidate);
+   uint8_t diff = len != sizeof(secret) - 1;
+   for (size_t i = 0; i < sizeof(secret) - 1; i++) {
+     diff |= secret[i] ^ (i < len ? candidate[i] : 0);
+   }
+   return diff == 0;
+ }
+ 
+ /**
+  * 7) Applies queued remote commands and times gate commands from receipt to
+  * the servo write.
+  */
+ void serviceRemote() {
+   while (remoteCount) {
+     RemoteCommand &rc = remoteQueue[remoteHead];
+     remoteHead = (remoteHead + 1) % REMOTE_QUEUE_LEN;
+     remoteCount--;
+ 
+     if (rc.type == MSG_CONFIG_SET) {
+       if (applyConfig(rc.cfg) == ACK_OK) journalAppend(EVT_CONFIG, rc.cfg.key, (uint16_t)rc.cfg.value);
+       continue;
+     }
+     if (rc.cmd.code == CMD_OPEN_GATE) openGate(2);
+     else closeGate();
+     recordLatency(histograms[HIST_REMOTE], micros() - rc.receivedUs);
+   }
+ }
+ 
+ /**
+  * Adds one latency sample to a log2 histogram.
+  */
+ void recordLatency(LatencyHistogram &hist, uint32_t us) {
+   uint8_t bucket = us ? 31 - __builtin_clz(us) : 0;
+   if (bucket >= HISTOGRAM_BUCKETS) bucket = HISTOGRAM_BUCKETS - 1;
+   hist.buckets[bucket]++;
+   if (us > hist.maxUs) hist.maxUs = us;
+ }
+ 
+ /**
+  * Opens the gate; source is 0 for RFID, 1 for a serial command and 2 for a remote one.
+  */
+ void openGate(uint8_t source) {
+   gateServo.write(0);               // Open gate
+   gateOpen = true;
+   gateGrant++;
+   journalAppend(EVT_GATE_OPEN, source, 0);
+ }
+ 
+ /**
+  * Closes the gate.
+  */
+ void closeGate() {
+   gateServo.write(90);              // Close gate
+   gateOpen = false;
+   journalAppend(EVT_GATE_CLOSE, 0, 0);
  }
  
  /**
@@ -187,7 +1299,8 @@
  }
  
  /**
-  * Reads and returns distance (in cm) from ultrasonic sensor.
+  * Reads and returns distance (in cm) from ultrasonic sensor, or -1 if no echo
+  * arrived within ECHO_TIMEOUT_US.
   */
  float readDistanceCM() {
    digitalWrite(TRIG_PIN, LOW);
@@ -196,6 +1309,700 @@
    delayMicroseconds(10);
    digitalWrite(TRIG_PIN, LOW);
  
-   long duration = pulseIn(ECHO_PIN, HIGH);
+   long duration = pulseIn(ECHO_PIN, HIGH, ECHO_TIMEOUT_US);   // Default timeout is a full second
+   if (duration == 0) return -1.0f;
    return duration * 0.034f / 2.0f;
- } 
+ }
+ 
+ /**
+  * Records a new occupied-spot count in the current trend bucket and refreshes
+  * the forecast.
+  */
+ void updateOccupancyAggregates(int occupied) {
+   int change = occupied - occupiedSpots;
+   trendBuckets[trendBucket] += change;
+   trendWindowSum += change;
+   occupiedSpots = occupied;
+   refreshForecast();
+ }
+ 
+ /**
+  * Extrapolates the window's net change over the forecast horizon.
+  */
+ void refreshForecast() {
+   long forecast = occupiedSpots + (long)trendWindowSum * FORECAST_HORIZON_MIN / TREND_WINDOW_MIN;
+   forecastOccupied = constrain(forecast, 0L, (long)totalSpots);
+ }
+ 
+ /**
+  * Once a minute: drops the oldest minute from the trend window. A quiet lot's
+  * trend thereby returns to zero, and with it the forecast to the current count.
+  * Re-prices only if an expiring change moves the forecast out of the tier's bounds.
+  */
+ void advanceTrend() {
+   trendBucket = (trendBucket + 1) % TREND_WINDOW_MIN;
+   int expired = trendBuckets[trendBucket];
+   trendBuckets[trendBucket] = 0;
+   if (expired == 0) return;
+   trendWindowSum -= expired;
+   refreshForecast();
+   if (forecastOccupied < tierLowerBound || forecastOccupied >= tierUpperBound) {
+     updatePriceTier();
+   }
+ }
+ 
+ /**
+  * Converts an occupancy percentage into the smallest spot count that reaches it.
+  */
+ int spotsForPct(int pct) {
+   if (pct <= 0) return 0;
+   return (pct * totalSpots + 99) / 100;
+ }
+ 
+ /**
+  * Re-evaluates the price tier from the forecast with hysteresis, caches the
+  * spot-count bounds that will trigger the next evaluation and publishes changes.
+  */
+ void updatePriceTier() {
+   uint8_t tier = priceTier;
+   int pct = forecastOccupied * 100 / totalSpots;
+ 
+   while (tier + 1 < PRICE_TIERS && pct >= tierEnterPct[tier + 1]) tier++;
+   while (tier > 0 && pct < tierEnterPct[tier] - TIER_HYSTERESIS_PCT) tier--;
+ 
+   tierLowerBound = tier > 0 ? spotsForPct(tierEnterPct[tier] - TIER_HYSTERESIS_PCT) : 0;
+   tierUpperBound = tier + 1 < PRICE_TIERS ? spotsForPct(tierEnterPct[tier + 1]) : totalSpots + 1;
+ 
+   if (tier != priceTier) {
+     priceTier = tier;
+     journalAppend(EVT_PRICE_TIER, tier, tierPriceCents[tier]);
+     Serial.print(F("Price tier ")); Serial.print(tier);
+     Serial.print(F(" – ")); Serial.print(tierPriceCents[tier]); Serial.println(F(" c/h"));
+     cloudDirty |= CLOUD_PIN_PRICE;
+   }
+ }
+ 
+ /**
+  * Returns true if the given spot is marked occupied in the bitmap.
+  */
+ bool spotOccupied(int spot) {
+   return occupancyBits[spot >> 3] & (1 << (spot & 7));
+ }
+ 
+ /**
+  * Returns true if the spot's sensor is unhealthy and its state unknown.
+  */
+ bool spotUnknown(int spot) {
+   return unknownBits[spot >> 3] & (1 << (spot & 7));
+ }
+ 
+ /**
+  * Marker for a spot: '?' unknown, 'X' occupied, 'O' free.
+  */
+ char spotGlyph(int spot) {
+   return spotUnknown(spot) ? '?' : spotOccupied(spot) ? 'X' : 'O';
+ }
+ 
+ /**
+  * Sets or clears a spot's bit in the occupancy bitmap.
+  */
+ void setSpotOccupied(int spot, bool occupied) {
+   if (occupied) occupancyBits[spot >> 3] |= (1 << (spot & 7));
+   else          occupancyBits[spot >> 3] &= ~(1 << (spot & 7));
+ }
+ 
+ /**
+  * Pushes the occupancy bitmap to the LED chain if it changed since the last frame.
+  * The whole chain goes out in one SPI transaction (~1 µs per spot at 8 MHz), so
+  * MFRC522 traffic on the shared bus can never interleave with a partial frame.
+  */
+ void updateSpotLeds() {
+   if (ledFrameValid && memcmp(ledShownBits, occupancyBits, sizeof(occupancyBits)) == 0 &&
+       memcmp(ledShownUnknown, unknownBits, sizeof(unknownBits)) == 0) return;
+ 
+   // Last byte shifted out lands in the register nearest the board (spots 1-4)
+   for (int i = 0; i < ledFrameBytes; i++) {
+     byte nibble = (occupancyBits[i >> 1] >> ((i & 1) * 4)) & 0x0F;
+     ledFrame[ledFrameBytes - 1 - i] = ledNibbleLUT[nibble];
+   }
+   if (totalSpots % 4) ledFrame[0] &= (1 << (2 * (totalSpots % 4))) - 1;  // Unwired outputs off
+   for (int i = 0; i < totalSpots; i++) {
+     if (spotUnknown(i)) ledFrame[ledFrameBytes - 1 - i / 4] &= ~(3 << (2 * (i % 4)));
+   }
+ 
+   SPI.beginTransaction(SPISettings(LED_SPI_HZ, MSBFIRST, SPI_MODE0));
+   digitalWrite(LED_LATCH_PIN, LOW);
+   SPI.transfer(ledFrame, ledFrameBytes);  // In-place; the frame is re-rendered every time
+   digitalWrite(LED_LATCH_PIN, HIGH);      // Rising edge latches the new pattern
+   SPI.endTransaction();
+ 
+   memcpy(ledShownBits, occupancyBits, sizeof(occupancyBits));
+   memcpy(ledShownUnknown, unknownBits, sizeof(unknownBits));
+   ledFrameValid = true;
+ }
+ 
+ /**
+  * Appends an event to the RAM journal, overwriting the oldest record when full.
+  */
+ void journalAppend(uint8_t type, uint8_t arg, uint16_t value) {
+   JournalRecord &rec = journal[journalNextSeq % JOURNAL_CAPACITY];
+   rec.seq = journalNextSeq++;
+   rec.stamp = journalStamp();
+   rec.type = type;
+   rec.arg = arg;
+   rec.value = value;
+ }
+ 
+ /**
+  * Current journal timestamp (see protocol.h): synced wall time in tenths of a
+  * second since JOURNAL_EPOCH_UNIX, never going backwards, or boot-relative
+  * milliseconds flagged STAMP_UNSYNCED.
+  */
+ uint32_t journalStamp() {
+   unsigned long now = millis();
+   if (!clockSynced) return STAMP_UNSYNCED | (now & ~STAMP_UNSYNCED);
+   uint32_t stamp = stampFromUnixMs(wallClockMs(now));
+   if (stamp < journalLastStamp) stamp = journalLastStamp;
+   journalLastStamp = stamp;
+   return stamp;
+ }
+ 
+ /**
+  * Wall-clock estimate (Unix ms) for a millis() reading.
+  */
+ uint64_t wallClockMs(unsigned long mono) {
+   long elapsed = mono - syncMonoMs;
+   return syncUnixMs + elapsed + (int64_t)elapsed * driftPpm / 1000000;
+ }
+ 
+ /**
+  * Unix ms → synced journal stamp.
+  */
+ uint32_t stampFromUnixMs(uint64_t unixMs) {
+   return (unixMs - JOURNAL_EPOCH_UNIX * 1000ULL) / (1000 / STAMP_TICKS_PER_SEC);
+ }
+ 
+ /**
+  * 8) SNTP client: sends a request when due and picks up the reply on a later
+  * pass, so the loop never waits on the network.
+  */
+ void syncClock() {
+   if (linkState == LINK_OFFLINE) {
+     ntpPending = ntpListening = false;
+     return;
+   }
+   unsigned long now = millis();
+ 
+   if (!ntpPending) {
+     if ((long)(now - nextNtpMs) < 0 || !ntpResolved) return;
+     if (!ntpListening) ntpListening = ntpUdp.begin(NTP_LOCAL_PORT) == 1;
+     uint8_t request[48] = { 0x1B };         // LI 0, version 3, client mode
+     while (ntpUdp.parsePacket() > 0);       // Drop late replies to earlier requests
+     ntpUdp.beginPacket(ntpAddress, NTP_PORT);
+     ntpUdp.write(request, sizeof(request));
+     ntpSentUs = micros();
+     ntpPending = ntpUdp.endPacket() == 1;
+     ntpSentMs = millis();
+     if (!ntpPending) nextNtpMs = now + NTP_RETRY_MS;
+     return;
+   }
+ 
+   if (ntpUdp.parsePacket() < 48) {
+     if (now - ntpSentMs >= NTP_TIMEOUT_MS) {
+       ntpPending = false;
+ #ifndef NTP_SERVER_IP
+       ntpResolved = false;                  // The server may have moved
+ #endif
+       nextNtpMs = now + NTP_RETRY_MS;
+     }
+     return;
+   }
+   ntpPending = false;
+ 
+   // Stamped as the reply is read, not when the task was released
+   unsigned long receivedUs = micros(), receivedMs = millis();
+   uint8_t reply[48];
+   ntpUdp.read(reply, sizeof(reply));
+   uint8_t stratum = reply[1];
+   if ((reply[0] & 0x07) != 4 || stratum == 0 || stratum > 15) {
+     nextNtpMs = now + NTP_RETRY_MS;         // Not a server reply, or kiss-o'-death
+     return;
+   }
+ 
+   // Server receive (T2) and transmit (T3) times, NTP era 0 → Unix ms
+   uint64_t t2 = ntpTimestampMs(reply + 32), t3 = ntpTimestampMs(reply + 40);
+   long delay = (long)((receivedUs - ntpSentUs) / 1000) - (long)(t3 - t2);
+   if (delay < 0 || delay > NTP_MAX_DELAY_MS) {
+     nextNtpMs = now + NTP_RETRY_MS;
+     return;
+   }
+   applyTimeSample(t3 + delay / 2, receivedMs);
+   nextNtpMs = now + NTP_INTERVAL_MS;
+ }
+ 
+ /**
+  * Decodes a 64-bit NTP timestamp (seconds since 1900 + binary fraction) to Unix ms.
+  */
+ uint64_t ntpTimestampMs(const uint8_t *p) {
+   uint32_t seconds = (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+   uint32_t fraction = (uint32_t)p[4] << 24 | (uint32_t)p[5] << 16 | (uint32_t)p[6] << 8 | p[7];
+   return (uint64_t)(seconds - 2208988800UL) * 1000 + (((uint64_t)fraction * 1000) >> 32);
+ }
+ 
+ /**
+  * Folds one (wall clock, millis) sample into the model: the residual against
+  * the prediction refines the drift estimate, then the sync point moves here.
+  */
+ void applyTimeSample(uint64_t unixMs, unsigned long mono) {
+   bool first = !clockSynced;
+   long correction = 0;
+   if (!first) {
+     correction = (long)((int64_t)unixMs - (int64_t)wallClockMs(mono));
+     long span = mono - syncMonoMs;
+     if (span >= NTP_DRIFT_MIN_SPAN_MS) {
+       driftPpm += (long)((int64_t)correction * 1000000 / span) / 2;
+       driftPpm = constrain(driftPpm, -NTP_MAX_DRIFT_PPM, NTP_MAX_DRIFT_PPM);
+     }
+   }
+   syncUnixMs = unixMs;
+   syncMonoMs = mono;
+   clockSynced = true;
+ 
+   if (first) rebaseJournalStamps();
+   long magnitude = correction < 0 ? -correction : correction;
+   journalAppend(EVT_TIME_SYNC, first, magnitude > 65535 ? 65535 : magnitude);
+ }
+ 
+ /**
+  * Converts boot-relative stamps still in RAM to wall time after the first sync.
+  */
+ void rebaseJournalStamps() {
+   unsigned long now = millis();
+   for (uint32_t seq = journalOldestSeq(); seq < journalNextSeq; seq++) {
+     JournalRecord &rec = journal[seq % JOURNAL_CAPACITY];
+     if (!(rec.stamp & STAMP_UNSYNCED)) continue;
+     unsigned long mono = rec.stamp & ~STAMP_UNSYNCED;
+     if (mono > now) continue;               // Older than 2^31 ms; cannot be placed
+     rec.stamp = stampFromUnixMs(wallClockMs(mono));
+   }
+ }
+ 
+ /**
+  * Sequence number of the oldest record still held in the journal.
+  */
+ uint32_t journalOldestSeq() {
+   return journalNextSeq > JOURNAL_CAPACITY ? journalNextSeq - JOURNAL_CAPACITY : 0;
+ }
+ 
+ /**
+  * Encodes and queues one frame. Returns false (and sends nothing) if the
+  * serial TX buffer cannot take the whole frame right now.
+  */
+ bool sendFrame(uint8_t type, uint8_t seq, const void *payload, size_t len) {
+   size_t n = buildFrame(type, seq, payload, len, linkFrame);
+   if (n == 0 || Serial.availableForWrite() < (int)n) return false;
+   Serial.write(linkFrame, n);
+   return true;
+ }
+ 
+ /**
+  * Services the binary link: decodes a bounded number of received bytes,
+  * advances an active journal dump, export or OTA base check and streams
+  * telemetry when due.
+  */
+ void serviceLink() {
+   for (int budget = LINK_RX_BUDGET; budget > 0 && Serial.available() > 0; budget--) {
+     if (linkDecoder.feed(Serial.read())) handleFrame();
+   }
+ 
+   while (journalDumpActive) {
+     if (journalDumpSeq < journalOldestSeq()) journalDumpSeq = journalOldestSeq();  // Overwritten meanwhile
+     if (journalDumpSeq >= journalNextSeq) {
+       JournalEnd end = { journalNextSeq };
+       if (!sendFrame(MSG_JOURNAL_END, linkTxSeq, &end, sizeof(end))) break;
+       linkTxSeq++;
+       journalDumpActive = false;
+       break;
+     }
+     JournalRecord batch[JOURNAL_RECORDS_PER_FRAME];
+     uint8_t count = 0;
+     for (uint32_t seq = journalDumpSeq; seq < journalNextSeq && count < JOURNAL_RECORDS_PER_FRAME; seq++) {
+       batch[count++] = journal[seq % JOURNAL_CAPACITY];
+     }
+     if (!sendFrame(MSG_JOURNAL_DATA, linkTxSeq, batch, count * sizeof(JournalRecord))) break;
+     linkTxSeq++;
+     journalDumpSeq += count;
+   }
+ 
+   serviceExport();
+   hashOtaBase();
+ 
+   if (telemetryPeriodMs && millis() - lastTelemetryMs >= telemetryPeriodMs) {
+     uint8_t payload[sizeof(TelemetryMsg) + 2 * sizeof(occupancyBits) + TASK_COUNT * sizeof(TaskStats)];
+     TelemetryMsg msg;
+     msg.uptimeMs = millis();
+     msg.journalNextSeq = journalNextSeq;
+     msg.priceCents = tierPriceCents[priceTier];
+     msg.totalSpots = totalSpots;
+     msg.availableSpots = availableSpots;
+     msg.priceTier = priceTier;
+     msg.gateOpen = gateOpen;
+     msg.loopCyclesAvg = loopPasses ? loopCyclesSum / loopPasses : 0;
+     msg.loopCyclesMax = loopCyclesMax;
+     msg.linkState = linkState;
+     msg.rssiDbm = linkRssi;
+     msg.linkDrops = linkDrops;
+     msg.eventDrops[CHANNEL_OCCUPANCY] = occupancyEvents.dropped();
+     msg.eventDrops[CHANNEL_CARD] = cardEvents.dropped();
+     msg.eventDrops[CHANNEL_PASSAGE] = passageEvents.dropped();
+     msg.eventDrops[CHANNEL_HEALTH] = healthEvents.dropped();
+     msg.fsrOverruns = fsrBlocks.overruns();
+     msg.taskCount = TASK_COUNT;
+     size_t off = sizeof(msg);
+     memcpy(payload, &msg, sizeof(msg));
+     memcpy(payload + off, occupancyBits, sizeof(occupancyBits));
+     off += sizeof(occupancyBits);
+     memcpy(payload + off, unknownBits, sizeof(unknownBits));
+     off += sizeof(unknownBits);
+     for (size_t i = 0; i < TASK_COUNT; i++, off += sizeof(TaskStats)) {
+       TaskStats stats = { tasks[i].priority, tasks[i].misses, tasks[i].wcetUs };
+       memcpy(payload + off, &stats, sizeof(stats));
+     }
+     if (sendFrame(MSG_TELEMETRY, linkTxSeq, payload, sizeof(payload))) {
+       linkTxSeq++;
+       lastTelemetryMs = millis();
+       loopPasses = 0;                 // Start a new profiling window
+       loopCyclesSum = 0;
+       loopCyclesMax = 0;
+     }
+   }
+ }
+ 
+ /**
+  * Acts on one decoded frame and acknowledges host requests.
+  */
+ void handleFrame() {
+   const uint8_t *payload = linkDecoder.payload();
+   size_t len = linkDecoder.length();
+   uint8_t status = ACK_OK;
+ 
+   switch (linkDecoder.type()) {
+     case MSG_JOURNAL_REQ: {
+       if (len != sizeof(JournalReq)) { status = ACK_BAD_LENGTH; break; }
+       JournalReq req;
+       memcpy(&req, payload, sizeof(req));
+       journalDumpSeq = req.fromSeq;
+       journalDumpActive = true;
+       return;                       // Answered by the data frames themselves
+     }
+     case MSG_EXPORT_REQ: {
+       if (len != sizeof(ExportReq)) { status = ACK_BAD_LENGTH; break; }
+       ExportReq req;
+       memcpy(&req, payload, sizeof(req));
+       if (req.window == 0 || req.window > EXPORT_MAX_WINDOW) { status = ACK_BAD_ARGUMENT; break; }
+       exportWindow = req.window;
+       // A resume point from an earlier boot means nothing now: send this boot's journal from the start
+       exportAckedSeq = exportSendSeq = req.bootId == bootId ? req.fromSeq : 0;
+       exportEndSeq = journalNextSeq;
+       exportProgressMs = millis();
+       exportActive = true;
+       return;                       // Answered by the data frames themselves
+     }
+     case MSG_EXPORT_ACK: {
+       if (len != sizeof(ExportAck) || !exportActive) return;
+       ExportAck ack;
+       memcpy(&ack, payload, sizeof(ack));
+       if (ack.nextSeq > exportAckedSeq && ack.nextSeq <= exportEndSeq) {
+         exportAckedSeq = ack.nextSeq;
+         exportProgressMs = millis();
+       }
+       return;                       // Acks are not acknowledged
+     }
+     case MSG_CONFIG_SET: {
+       if (len != sizeof(ConfigSet)) { status = ACK_BAD_LENGTH; break; }
+       ConfigSet cfg;
+       memcpy(&cfg, payload, sizeof(cfg));
+       status = applyConfig(cfg);
+       if (status == ACK_OK) journalAppend(EVT_CONFIG, cfg.key, (uint16_t)cfg.value);
+       break;
+     }
+     case MSG_COMMAND: {
+       if (len != sizeof(CommandMsg)) { status = ACK_BAD_LENGTH; break; }
+       CommandMsg cmd;
+       memcpy(&cmd, payload, sizeof(cmd));
+       if (cmd.code == CMD_OPEN_GATE) openGate(1);
+       else if (cmd.code == CMD_CLOSE_GATE) closeGate();
+       else if (cmd.code != CMD_PING) status = ACK_UNKNOWN;
+       break;
+     }
+     case MSG_OTA_BEGIN:
+     case MSG_OTA_DATA:
+     case MSG_OTA_END:
+     case MSG_OTA_ACTIVATE:
+       status = handleOtaFrame(linkDecoder.type(), payload, len);
+       if (status == ACK_DEFERRED) return;
+       break;
+     case MSG_HISTOGRAM_REQ: {
+       if (len != sizeof(HistogramReq)) { status = ACK_BAD_LENGTH; break; }
+       HistogramReq req;
+       memcpy(&req, payload, sizeof(req));
+       if (req.id >= HIST_COUNT) { status = ACK_BAD_ARGUMENT; break; }
+       HistogramMsg msg;
+       msg.id = req.id;
+       msg.maxUs = histograms[req.id].maxUs;
+       memcpy(msg.buckets, histograms[req.id].buckets, sizeof(msg.buckets));
+       if (sendFrame(MSG_HISTOGRAM, linkDecoder.seq(), &msg, sizeof(msg)) && req.reset) {
+         memset(&histograms[req.id], 0, sizeof(LatencyHistogram));
+       }
+       return;                       // Answered by the histogram frame itself
+     }
+     default:
+       status = ACK_UNKNOWN;
+       break;
+   }
+ 
+   AckMsg ack = { linkDecoder.type(), status };
+   sendFrame(MSG_ACK, linkDecoder.seq(), &ack, sizeof(ack));
+ }
+ 
+ /**
+  * Steps the firmware update exchange: BEGIN starts checking the delta's base
+  * against the running sketch (hashOtaBase() answers it), DATA feeds the op
+  * stream in order (a repeated chunk whose ack was lost is acknowledged again),
+  * END verifies the rebuilt image and ACTIVATE installs it.
+  */
+ uint8_t handleOtaFrame(uint8_t type, const uint8_t *payload, size_t len) {
+   switch (type) {
+     case MSG_OTA_BEGIN: {
+       if (len != sizeof(DeltaHeader)) return ACK_BAD_LENGTH;
+       memcpy(&otaHeader, payload, sizeof(otaHeader));
+       if (otaHeader.magic != DELTA_MAGIC || otaHeader.baseLength > OTA_SLOT_SIZE) {
+         otaState = OTA_IDLE;
+         return ACK_BAD_ARGUMENT;
+       }
+       otaBaseSha.reset();
+       otaBaseHashed = 0;
+       otaBeginSeq = linkDecoder.seq();
+       otaBeginStatus = ACK_DEFERRED;
+       otaState = OTA_HASHING;
+       return ACK_DEFERRED;
+     }
+     case MSG_OTA_DATA: {
+       if (otaState != OTA_RECEIVING) return ACK_BAD_STATE;
+       if (len < sizeof(OtaData)) return ACK_BAD_LENGTH;
+       OtaData chunk;
+       memcpy(&chunk, payload, sizeof(chunk));
+       size_t bytes = len - sizeof(chunk);
+       if (chunk.offset + bytes == otaStreamOffset) return ACK_OK;           // Retransmission
+       if (chunk.offset != otaStreamOffset) return ACK_BAD_ARGUMENT;
+       if (!otaApplier.feed(payload + sizeof(chunk), bytes)) {
+         otaState = OTA_IDLE;
+         journalAppend(EVT_OTA, 2, 0);
+         return ACK_VERIFY_FAILED;
+       }
+       otaStreamOffset += bytes;
+       return ACK_OK;
+     }
+     case MSG_OTA_END: {
+       if (otaState != OTA_RECEIVING || !otaApplier.complete()) return ACK_BAD_STATE;
+       uint8_t digest[32];
+       bool ok = otaStaging.finish(digest) && memcmp(digest, otaHeader.targetSha256, sizeof(digest)) == 0;
+       otaState = ok ? OTA_VERIFIED : OTA_IDLE;
+       journalAppend(EVT_OTA, ok ? 1 : 2, otaHeader.targetLength >> 10);
+       return ok ? ACK_OK : ACK_VERIFY_FAILED;
+     }
+     default: {                      // MSG_OTA_ACTIVATE
+       if (otaState != OTA_VERIFIED || gateOpen || !otaStaging.canActivate()) return ACK_BAD_STATE;
+       journalAppend(EVT_OTA, 3, otaHeader.targetLength >> 10);
+       AckMsg ack = { type, ACK_OK };
+       sendFrame(MSG_ACK, linkDecoder.seq(), &ack, sizeof(ack));
+       Serial.flush();
+       otaStaging.activate();        // Does not return on supported boards
+       return ACK_BAD_STATE;
+     }
+   }
+ }
+ 
+ /**
+  * Hashes the next OTA_HASH_SLICE bytes of the running sketch for a pending
+  * BEGIN (a full slot in one go would take ~0.1 s) and answers the BEGIN once
+  * the whole base is checked.
+  */
+ void hashOtaBase() {
+   if (otaState == OTA_HASHING) {
+     uint32_t slice = min((uint32_t)OTA_HASH_SLICE, otaHeader.baseLength - otaBaseHashed);
+     otaBaseSha.update((const uint8_t *)OTA_APP_ADDR + otaBaseHashed, slice);
+     otaBaseHashed += slice;
+     if (otaBaseHashed < otaHeader.baseLength) return;
+ 
+     uint8_t digest[32];
+     otaBaseSha.finish(digest);
+     otaBeginStatus = ACK_OK;
+     if (memcmp(digest, otaHeader.baseSha256, sizeof(digest)) != 0) otaBeginStatus = ACK_BAD_ARGUMENT;
+     else if (!otaStaging.begin(otaHeader.targetLength)) otaBeginStatus = ACK_BAD_STATE;
+ 
+     otaState = OTA_IDLE;
+     if (otaBeginStatus == ACK_OK) {
+       otaApplier.begin((const uint8_t *)OTA_APP_ADDR, otaHeader.baseLength, otaHeader.targetLength);
+       otaStreamOffset = 0;
+       otaState = OTA_RECEIVING;
+       journalAppend(EVT_OTA, 0, otaHeader.targetLength >> 10);
+     }
+   }
+   if (otaBeginStatus == ACK_DEFERRED) return;
+   AckMsg ack = { MSG_OTA_BEGIN, otaBeginStatus };
+   if (sendFrame(MSG_ACK, otaBeginSeq, &ack, sizeof(ack))) otaBeginStatus = ACK_DEFERRED;   // Else next run
+ }
+ 
+ /**
+  * Applies a configuration change pushed over the link.
+  */
+ uint8_t applyConfig(const ConfigSet &cfg) {
+   switch (cfg.key) {
+     case CFG_FSR_THRESHOLD:
+       if (cfg.index >= totalSpots || cfg.value < 0 || cfg.value > 1023) return ACK_BAD_ARGUMENT;
+       fsrThresholds[cfg.index] = cfg.value;
+       return ACK_OK;
+     case CFG_TIER_PRICE:
+       if (cfg.index >= PRICE_TIERS || cfg.value < 0 || cfg.value > 65535) return ACK_BAD_ARGUMENT;
+       tierPriceCents[cfg.index] = cfg.value;
+       if (cfg.index == priceTier) cloudDirty |= CLOUD_PIN_PRICE;
+       return ACK_OK;
+     case CFG_TELEMETRY_MS:
+       if (cfg.value < 0) return ACK_BAD_ARGUMENT;
+       telemetryPeriodMs = cfg.value;
+       return ACK_OK;
+     default:
+       return ACK_UNKNOWN;
+   }
+ }
+ 
+ /**
+  * Streams journal records to the host for an active bulk export, keeping up to
+  * exportWindow frames unacknowledged and finishing once the host has them all.
+  */
+ void serviceExport() {
+   if (!exportActive) return;
+ 
+   uint32_t oldest = journalOldestSeq();
+   if (exportAckedSeq < oldest) exportAckedSeq = oldest;   // Overwritten before the host got them
+   if (exportSendSeq < exportAckedSeq) exportSendSeq = exportAckedSeq;
+ 
+   if (exportAckedSeq >= exportEndSeq) {
+     JournalEnd end = { exportEndSeq };
+     if (sendFrame(MSG_EXPORT_END, linkTxSeq, &end, sizeof(end))) {
+       linkTxSeq++;
+       exportActive = false;
+     }
+     return;
+   }
+ 
+   if (millis() - exportProgressMs >= EXPORT_RETRANSMIT_MS) {
+     exportSendSeq = exportAckedSeq;         // Lost frame or ack: go back
+     exportProgressMs = millis();
+   }
+ 
+   uint32_t windowEnd = exportAckedSeq + (uint32_t)exportWindow * EXPORT_RECORDS_PER_FRAME;
+   while (exportSendSeq < exportEndSeq && exportSendSeq < windowEnd) {
+     uint8_t payload[PROTO_MAX_PAYLOAD];
+     ExportData header = { bootId, oldest };
+     memcpy(payload, &header, sizeof(header));
+     size_t len = sizeof(header);
+ 
+     uint32_t seq = exportSendSeq;
+     for (; seq < exportEndSeq && len + sizeof(JournalRecord) <= PROTO_MAX_PAYLOAD; seq++) {
+       memcpy(payload + len, &journal[seq % JOURNAL_CAPACITY], sizeof(JournalRecord));
+       len += sizeof(JournalRecord);
+     }
+     if (!sendFrame(MSG_EXPORT_DATA, linkTxSeq, payload, len)) break;   // TX full, resume next pass
+     linkTxSeq++;
+     exportSendSeq = seq;
+   }
+ }
+ 
+ /**
+  * Sorts the task table by priority (stable) and releases every task now.
+  */
+ void startScheduler() {
+   for (size_t i = 1; i < TASK_COUNT; i++) {
+     Task task = tasks[i];
+     size_t j = i;
+     for (; j > 0 && tasks[j - 1].priority > task.priority; j--) tasks[j] = tasks[j - 1];
+     tasks[j] = task;
+   }
+   unsigned long now = micros();
+   for (Task &task : tasks) task.releaseUs = now;
+ }
+ 
+ /**
+  * Enables the DWT cycle counter where the core has one.
+  */
+ void startCycleCounter() {
+ #if defined(DWT) && defined(CoreDebug)
+   CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+   DWT->CYCCNT = 0;
+   DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+ #endif
+ }
+ 
+ /**
+  * Free-running CPU cycle count; wraps, so only differences are meaningful.
+  */
+ uint32_t cycleCount() {
+ #if defined(DWT) && defined(CoreDebug)
+   return DWT->CYCCNT;
+ #else
+   return micros() * (F_CPU / 1000000UL);
+ #endif
+ }
+ 
+ /**
+  * Blits a price in cents as dollars, e.g. 450 → "$4.50".
+  */
+ int16_t blitPrice(int16_t x, int16_t y, uint16_t cents) {
+   x = display.blitGlyph(x, y, '$');
+   x = display.blitUInt(x, y, cents / 100);
+   x = display.blitGlyph(x, y, '.');
+   x = display.blitGlyph(x, y, '0' + (cents % 100) / 10);
+   return display.blitGlyph(x, y, '0' + cents % 10);
+ }
+ 
+ /**
+  * Encodes a fresh session link and renders it into the framebuffer, where it
+  * stays until QR_SHOW_MS expires. Runs in event dispatch, so it sends nothing:
+  * animateDisplay() pushes the frame a page at a time.
+  */
+ void showSessionQr(uint16_t uidTag) {
+   // Session token: card tag mixed with the grant time (xorshift32 scramble).
+   // Journaled behind the grant so a backend can resolve the link to the session.
+   uint32_t token = ((uint32_t)uidTag << 16) ^ micros() ^ journalNextSeq;
+   token ^= token << 13; token ^= token >> 17; token ^= token << 5;
+   journalAppend(EVT_SESSION, 1, token >> 16);
+   journalAppend(EVT_SESSION, 0, token & 0xFFFF);
+ 
+   char payload[QR_MAX_PAYLOAD + 1] = QR_URL_PREFIX;
+   char *p = payload + strlen(payload);
+   for (int shift = 28; shift >= 0; shift -= 4) *p++ = "0123456789ABCDEF"[(token >> shift) & 0x0F];
+   *p = '\0';
+ 
+   uint32_t start = cycleCount();
+   if (!sessionQr.encode(payload)) return;
+   uint8_t side = (QR_SIZE + 2 * QR_QUIET_ZONE) * Layout::qrScale;
+   display.clearDisplay();
+   sessionQr.blit(display.getBuffer(), Display::WIDTH, Display::WIDTH - side, Layout::qrY, Layout::qrScale);
+   uint32_t cycles = cycleCount() - start;
+ 
+   display.setCursor(Layout::textX, Layout::titleY);
+   display.print(F("Granted"));
+   display.setCursor(Layout::textX, Layout::availableY);
+   display.print(F("Scan to"));
+   display.setCursor(Layout::textX, Layout::spotsY);
+   display.print(F("pay"));
+ 
+   bannerVisible = false;
+   qrVisible = true;
+   qrPagesPushed = 0;
+   qrShownAtMs = millis();
+   Serial.print(F("Session QR encoded + drawn in ")); Serial.print(cycles); Serial.println(F(" cycles"));
+ }
+
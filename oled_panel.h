@@ -0,0 +1,314 @@
+/**
+ * Monochrome I2C OLED driver family, specialized at compile time per panel.
+ *
+ * Panel geometry and controller quirks are traits structs, so every buffer index,
+ * page count and addressing branch below folds to constants for the chosen panel:
+ *
+ *  - SSD1306_128x64 / SSD1306_128x32 : horizontal addressing, whole frame in one burst
+ *  - SH1106_128x64                   : 132-column RAM (2-column offset), page addressing only
+ *
+ * OledPanel still derives from Adafruit_GFX so labels and splash art can be
+ * rasterized with its fonts at boot. Per-frame drawing goes through the non-virtual
+ * blitGlyph()/fillArea() members, which write framebuffer bytes directly.
+ */
+#pragma once
+
+#include <Wire.h>
+#include <Adafruit_GFX.h>
+
+#define OLED_BLACK    0
+#define OLED_WHITE    1
+#define OLED_INVERSE  2
+
+// —— Panel Traits ——
+struct SSD1306_128x64 {
+  static constexpr uint8_t width = 128, height = 64;
+  static constexpr uint8_t columnOffset = 0;
+  static constexpr bool pageAddressingOnly = false;
+  static constexpr uint8_t comPins = 0x12, contrast = 0xCF;
+};
+
+struct SSD1306_128x32 {
+  static constexpr uint8_t width = 128, height = 32;
+  static constexpr uint8_t columnOffset = 0;
+  static constexpr bool pageAddressingOnly = false;
+  static constexpr uint8_t comPins = 0x02, contrast = 0x8F;
+};
+
+struct SH1106_128x64 {
+  static constexpr uint8_t width = 128, height = 64;
+  static constexpr uint8_t columnOffset = 2;
+  static constexpr bool pageAddressingOnly = true;
+  static constexpr uint8_t comPins = 0x12, contrast = 0x80;
+};
+
+// —— Glyph Set ——
+// 5×7 cells from the classic GLCD font, stored column-major with bit 0 at the top,
+// which is exactly the controller's page format. Covers the characters of dynamic fields.
+#define GLYPH_WIDTH      5
+#define GLYPH_ADVANCE    6                 // One blank column between cells
+
+const uint8_t glyphDigits[10][GLYPH_WIDTH] = {
+  { 0x3E, 0x51, 0x49, 0x45, 0x3E }, { 0x00, 0x42, 0x7F, 0x40, 0x00 },
+  { 0x72, 0x49, 0x49, 0x49, 0x46 }, { 0x21, 0x41, 0x49, 0x4D, 0x33 },
+  { 0x18, 0x14, 0x12, 0x7F, 0x10 }, { 0x27, 0x45, 0x45, 0x45, 0x39 },
+  { 0x3C, 0x4A, 0x49, 0x49, 0x31 }, { 0x41, 0x21, 0x11, 0x09, 0x07 },
+  { 0x36, 0x49, 0x49, 0x49, 0x36 }, { 0x46, 0x49, 0x49, 0x29, 0x1E },
+};
+const char glyphSymbolChars[] = "$.OX?-";
+const uint8_t glyphSymbols[][GLYPH_WIDTH] = {
+  { 0x24, 0x2A, 0x7F, 0x2A, 0x12 },        // $
+  { 0x00, 0x60, 0x60, 0x00, 0x00 },        // .
+  { 0x3E, 0x41, 0x41, 0x41, 0x3E },        // O
+  { 0x63, 0x14, 0x08, 0x14, 0x63 },        // X
+  { 0x02, 0x01, 0x59, 0x09, 0x06 },        // ?
+  { 0x08, 0x08, 0x08, 0x08, 0x08 },        // -
+};
+const uint8_t glyphBlank[GLYPH_WIDTH] = { 0 };
+
+/**
+ * Column bytes for a character of the glyph set; unknown characters are blank.
+ */
+inline const uint8_t *glyphFor(char c) {
+  if (c >= '0' && c <= '9') return glyphDigits[c - '0'];
+  for (uint8_t i = 0; glyphSymbolChars[i]; i++) {
+    if (glyphSymbolChars[i] == c) return glyphSymbols[i];
+  }
+  return glyphBlank;
+}
+
+template <class Panel>
+class OledPanel : public Adafruit_GFX {
+ public:
+  static constexpr uint8_t WIDTH = Panel::width;
+  static constexpr uint8_t HEIGHT = Panel::height;
+  static constexpr uint8_t PAGES = Panel::height / 8;
+  static constexpr uint16_t BUFFER_SIZE = WIDTH * PAGES;
+
+  explicit OledPanel(TwoWire &wire) : Adafruit_GFX(WIDTH, HEIGHT), wire_(wire) {}
+
+  /**
+   * Initializes the controller; returns false if it does not acknowledge.
+   */
+  bool begin(uint8_t address = 0x3C) {
+    address_ = address;
+    wire_.begin();
+    wire_.setClock(400000);
+
+    static constexpr uint8_t common[] = {
+      0xAE,                                // Display off
+      0xD5, 0x80,                          // Clock divide / oscillator
+      0xA8, HEIGHT - 1,                    // Multiplex ratio
+      0xD3, 0x00,                          // Display offset
+      0x40,                                // Start line 0
+      0xA1,                                // Segment remap (column 127 → SEG0)
+      0xC8,                                // COM scan direction: remapped
+      0xDA, Panel::comPins,                // COM pin layout
+      0x81, Panel::contrast,
+      0xD9, 0xF1,                          // Pre-charge period
+      0xDB, 0x40,                          // VCOMH deselect level
+      0xA4,                                // Display follows RAM
+      0xA6,                                // Normal (not inverted)
+    };
+    static constexpr uint8_t ssd1306[] = {
+      0x8D, 0x14,                          // Internal charge pump on
+      0x20, 0x00,                          // Horizontal addressing
+      0x2E,                                // Scrolling off
+    };
+    static constexpr uint8_t sh1106[] = {
+      0xAD, 0x8B,                          // Internal DC-DC on
+    };
+
+    if (!commands(common, sizeof(common))) return false;
+    if (Panel::pageAddressingOnly) {
+      if (!commands(sh1106, sizeof(sh1106))) return false;
+    } else {
+      if (!commands(ssd1306, sizeof(ssd1306))) return false;
+    }
+    clearDisplay();
+    display();
+    return command(0xAF);                  // Display on
+  }
+
+  /**
+   * Pushes the whole framebuffer to the panel.
+   */
+  void display() { displayRegion(0, WIDTH, 0, PAGES - 1); }
+
+  /**
+   * Pushes columns [x0, x1) of pages page0..page1 only, so small changes cost
+   * a few bytes of I2C instead of the whole frame.
+   */
+  void displayRegion(int16_t x0, int16_t x1, uint8_t page0, uint8_t page1) {
+    if (x0 < 0) x0 = 0;
+    if (x1 > WIDTH) x1 = WIDTH;
+    if (page1 >= PAGES) page1 = PAGES - 1;
+    if (x0 >= x1 || page0 > page1) return;
+
+    uint8_t col = Panel::columnOffset + x0;
+    if (Panel::pageAddressingOnly) {
+      for (uint8_t page = page0; page <= page1; page++) {
+        const uint8_t window[] = {
+          (uint8_t)(0xB0 | page),
+          (uint8_t)(0x00 | (col & 0x0F)),
+          (uint8_t)(0x10 | (col >> 4)),
+        };
+        commands(window, sizeof(window));
+        data(buffer_ + page * WIDTH + x0, x1 - x0);
+      }
+    } else {
+      const uint8_t window[] = {
+        0x21, col, (uint8_t)(col + x1 - x0 - 1),
+        0x22, page0, page1,
+      };
+      commands(window, sizeof(window));
+      if (x0 == 0 && x1 == WIDTH) {
+        data(buffer_ + page0 * WIDTH, (page1 - page0 + 1) * WIDTH);
+      } else {
+        for (uint8_t page = page0; page <= page1; page++) data(buffer_ + page * WIDTH + x0, x1 - x0);
+      }
+    }
+  }
+
+  /**
+   * Pushes every page touched by rows [y, y + h) within columns [x0, x1).
+   */
+  void displayRows(int16_t x0, int16_t x1, int16_t y, int16_t h) {
+    if (h <= 0 || y >= HEIGHT) return;
+    if (y < 0) { h += y; y = 0; }
+    displayRegion(x0, x1, y >> 3, (y + h - 1) >> 3);
+  }
+
+  void clearDisplay() { memset(buffer_, 0, BUFFER_SIZE); }
+  uint8_t *getBuffer() { return buffer_; }
+
+  void drawPixel(int16_t x, int16_t y, uint16_t color) override {
+    if ((uint16_t)x >= WIDTH || (uint16_t)y >= HEIGHT) return;
+    uint8_t &b = buffer_[(y >> 3) * WIDTH + x];
+    uint8_t mask = 1 << (y & 7);
+    if (color == OLED_WHITE) b |= mask;
+    else if (color == OLED_BLACK) b &= ~mask;
+    else b ^= mask;
+  }
+
+  /**
+   * Writes one glyph cell straight into the framebuffer and returns the next x.
+   * On a page-aligned row every column is a single byte store; other rows split
+   * each column across two pages.
+   */
+  int16_t blitGlyph(int16_t x, int16_t y, char c) {
+    if (x < 0 || x + GLYPH_ADVANCE > WIDTH || y < 0 || y + 8 > HEIGHT) return x + GLYPH_ADVANCE;
+
+    const uint8_t *cols = glyphFor(c);
+    uint8_t *dst = buffer_ + (y >> 3) * WIDTH + x;
+    uint8_t shift = y & 7;
+
+    if (shift == 0) {
+      for (uint8_t i = 0; i < GLYPH_WIDTH; i++) dst[i] = cols[i];
+      dst[GLYPH_WIDTH] = 0;
+    } else {
+      uint8_t *below = dst + WIDTH;
+      uint8_t keepTop = 0xFF >> (8 - shift), keepBottom = 0xFF << shift;
+      for (uint8_t i = 0; i < GLYPH_ADVANCE; i++) {
+        uint8_t col = i < GLYPH_WIDTH ? cols[i] : 0;
+        dst[i] = (dst[i] & keepTop) | (col << shift);
+        below[i] = (below[i] & keepBottom) | (col >> (8 - shift));
+      }
+    }
+    return x + GLYPH_ADVANCE;
+  }
+
+  /**
+   * Blits a NUL-terminated string of glyph-set characters.
+   */
+  int16_t blitText(int16_t x, int16_t y, const char *text) {
+    while (*text) x = blitGlyph(x, y, *text++);
+    return x;
+  }
+
+  /**
+   * Blits an unsigned decimal number without going through Print.
+   */
+  int16_t blitUInt(int16_t x, int16_t y, uint32_t value) {
+    char digits[11];
+    char *p = digits + sizeof(digits) - 1;
+    *p = '\0';
+    do {
+      *--p = '0' + value % 10;
+      value /= 10;
+    } while (value);
+    return blitText(x, y, p);
+  }
+
+  /**
+   * Sets or clears a rectangle a page-byte at a time (no per-pixel calls).
+   */
+  void fillArea(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    if (x + w > WIDTH) w = WIDTH - x;
+    if (y + h > HEIGHT) h = HEIGHT - y;
+    if (w <= 0 || h <= 0) return;
+
+    for (int16_t top = y; top < y + h; top = (top | 7) + 1) {
+      int16_t bottom = min(y + h, (top | 7) + 1);          // Exclusive, within this page
+      uint8_t mask = (0xFF << (top & 7)) & (0xFF >> (8 - (bottom - ((top >> 3) << 3))));
+      uint8_t *dst = buffer_ + (top >> 3) * WIDTH + x;
+      for (int16_t i = 0; i < w; i++) {
+        if (color == OLED_WHITE) dst[i] |= mask;
+        else if (color == OLED_BLACK) dst[i] &= ~mask;
+        else dst[i] ^= mask;
+      }
+    }
+  }
+
+ private:
+  bool command(uint8_t c) { return commands(&c, 1); }
+
+  bool commands(const uint8_t *cmds, uint8_t n) {
+    wire_.beginTransmission(address_);
+    wire_.write((uint8_t)0x00);            // Co = 0, D/C = 0: command stream
+    wire_.write(cmds, n);
+    return wire_.endTransmission() == 0;
+  }
+
+  void data(const uint8_t *bytes, uint16_t n) {
+    // Chunked so each transfer fits the smallest Wire buffers (32 bytes)
+    while (n) {
+      uint8_t chunk = n > 16 ? 16 : n;
+      wire_.beginTransmission(address_);
+      wire_.write((uint8_t)0x40);          // Co = 0, D/C = 1: data stream
+      wire_.write(bytes, chunk);
+      wire_.endTransmission();
+      bytes += chunk;
+      n -= chunk;
+    }
+  }
+
+  TwoWire &wire_;
+  uint8_t address_ = 0x3C;
+  uint8_t buffer_[BUFFER_SIZE];
+};
+
+// —— Screen Layout ——
+// Row positions per panel height. Text rows sit on page boundaries so glyph
+// columns are single byte stores.
+template <uint8_t Height> struct ScreenLayout;
+
+template <> struct ScreenLayout<64> {
+  static constexpr bool border = true;
+  static constexpr int16_t textX = 10;
+  static constexpr int16_t titleY = 8, availableY = 24, spotsY = 40;
+  static constexpr int16_t barY = 55, barHeight = 5;
+  static constexpr uint8_t qrScale = 2;
+  static constexpr int16_t qrY = 2;                   // Multiple of qrScale
+};
+
+template <> struct ScreenLayout<32> {
+  static constexpr bool border = false;
+  static constexpr int16_t textX = 2;
+  static constexpr int16_t titleY = 0, availableY = 8, spotsY = 16;
+  static constexpr int16_t barY = 27, barHeight = 4;
+  static constexpr uint8_t qrScale = 1;
+  static constexpr int16_t qrY = 1;
+};
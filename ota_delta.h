@@ -0,0 +1,208 @@
+/**
+ * Binary delta format for firmware updates, shared by the controller and host tools.
+ *
+ * A delta rebuilds a target image from the image already running (the base):
+ *
+ *   DeltaHeader | op*
+ *
+ *   COPY : 0x00 | srcOffset u32 | length u16     target ← base[srcOffset, +length)
+ *   ADD  : 0x01 | length u16 | bytes[length]     target ← literal bytes
+ *
+ * Ops append to the target in order. The header carries SHA-256 digests of both
+ * images: the base digest makes sure a delta is only applied to the image it was
+ * built against, and the target digest is checked on the rebuilt image before it
+ * may be activated. DeltaApplier consumes the op stream in arbitrary chunks, so it
+ * can sit directly behind a transport without buffering whole ops.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define DELTA_MAGIC    0x4C444B50UL                // "PKDL"
+#define DELTA_OP_COPY  0x00
+#define DELTA_OP_ADD   0x01
+#define DELTA_MAX_RUN  0xFFFF                      // Longest COPY or ADD
+
+struct __attribute__((packed)) DeltaHeader {
+  uint32_t magic;
+  uint32_t baseLength;
+  uint32_t targetLength;
+  uint8_t  baseSha256[32];
+  uint8_t  targetSha256[32];
+};
+
+// —— SHA-256 (FIPS 180-4), streaming ——
+class Sha256 {
+ public:
+  Sha256() { reset(); }
+
+  void reset() {
+    static const uint32_t init[8] = {
+      0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+    memcpy(h_, init, sizeof(h_));
+    length_ = 0;
+  }
+
+  void update(const void *data, size_t len) {
+    const uint8_t *p = (const uint8_t *)data;
+    size_t used = length_ % 64;
+    length_ += len;
+    if (used) {
+      size_t take = 64 - used < len ? 64 - used : len;
+      memcpy(block_ + used, p, take);
+      p += take;
+      len -= take;
+      if (used + take < 64) return;
+      compress(block_);
+    }
+    for (; len >= 64; p += 64, len -= 64) compress(p);
+    memcpy(block_, p, len);
+  }
+
+  void finish(uint8_t digest[32]) {
+    uint64_t bits = length_ * 8;
+    uint8_t pad[72] = { 0x80 };
+    size_t padLen = (length_ % 64 < 56 ? 56 : 120) - length_ % 64;
+    for (int i = 0; i < 8; i++) pad[padLen + i] = bits >> (56 - 8 * i);
+    update(pad, padLen + 8);
+    for (int i = 0; i < 32; i++) digest[i] = h_[i / 4] >> (24 - 8 * (i % 4));
+  }
+
+ private:
+  static uint32_t ror(uint32_t x, uint8_t n) { return x >> n | x << (32 - n); }
+
+  void compress(const uint8_t *p) {
+    static const uint32_t k[64] = {
+      0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+      0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+      0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+      0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+      0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+      0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+      0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+      0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+    };
+    uint32_t w[16];
+    for (int i = 0; i < 16; i++) {
+      w[i] = (uint32_t)p[4 * i] << 24 | (uint32_t)p[4 * i + 1] << 16 | (uint32_t)p[4 * i + 2] << 8 | p[4 * i + 3];
+    }
+    uint32_t a = h_[0], b = h_[1], c = h_[2], d = h_[3], e = h_[4], f = h_[5], g = h_[6], h = h_[7];
+    for (int i = 0; i < 64; i++) {
+      if (i >= 16) {                     // Message schedule kept as a 16-word ring
+        uint32_t w15 = w[(i - 15) & 15], w2 = w[(i - 2) & 15];
+        w[i & 15] += (ror(w15, 7) ^ ror(w15, 18) ^ (w15 >> 3)) + w[(i - 7) & 15] +
+                     (ror(w2, 17) ^ ror(w2, 19) ^ (w2 >> 10));
+      }
+      uint32_t t1 = h + (ror(e, 6) ^ ror(e, 11) ^ ror(e, 25)) + ((e & f) ^ (~e & g)) + k[i] + w[i & 15];
+      uint32_t t2 = (ror(a, 2) ^ ror(a, 13) ^ ror(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+      h = g; g = f; f = e; e = d + t1;
+      d = c; c = b; b = a; a = t1 + t2;
+    }
+    h_[0] += a; h_[1] += b; h_[2] += c; h_[3] += d;
+    h_[4] += e; h_[5] += f; h_[6] += g; h_[7] += h;
+  }
+
+  uint32_t h_[8];
+  uint8_t block_[64];
+  uint64_t length_;
+};
+
+/**
+ * Streaming delta interpreter. Sink needs bool write(const uint8_t *data, size_t len),
+ * which receives the rebuilt target in order; COPY data is passed straight from
+ * the base image, so the base must stay readable (e.g. memory-mapped flash).
+ */
+template<class Sink>
+class DeltaApplier {
+ public:
+  explicit DeltaApplier(Sink &sink) : sink_(sink) {}
+
+  void begin(const uint8_t *base, uint32_t baseLength, uint32_t targetLength) {
+    base_ = base;
+    baseLength_ = baseLength;
+    targetLength_ = targetLength;
+    written_ = 0;
+    state_ = OP;
+    failed_ = false;
+  }
+
+  /**
+   * Consumes the next chunk of the op stream. Returns false, and stays failed,
+   * on a malformed op, a COPY outside the base, target overrun or a sink error.
+   */
+  bool feed(const uint8_t *data, size_t len) {
+    while (len && !failed_) {
+      switch (state_) {
+        case OP:
+          op_ = *data++;
+          len--;
+          if (op_ != DELTA_OP_COPY && op_ != DELTA_OP_ADD) return fail();
+          argPos_ = 0;
+          argLen_ = op_ == DELTA_OP_COPY ? 6 : 2;
+          state_ = ARGS;
+          break;
+
+        case ARGS:
+          args_[argPos_++] = *data++;
+          len--;
+          if (argPos_ < argLen_) break;
+          if (op_ == DELTA_OP_COPY) {
+            uint32_t src = args_[0] | (uint32_t)args_[1] << 8 | (uint32_t)args_[2] << 16 | (uint32_t)args_[3] << 24;
+            uint16_t run = args_[4] | args_[5] << 8;
+            if (src > baseLength_ || run > baseLength_ - src || !emit(base_ + src, run)) return fail();
+            state_ = OP;
+          } else {
+            remaining_ = args_[0] | args_[1] << 8;
+            state_ = remaining_ ? LITERAL : OP;
+          }
+          break;
+
+        case LITERAL: {
+          size_t take = remaining_ < len ? remaining_ : len;
+          if (!emit(data, take)) return fail();
+          data += take;
+          len -= take;
+          remaining_ -= take;
+          if (!remaining_) state_ = OP;
+          break;
+        }
+      }
+    }
+    return !failed_;
+  }
+
+  // True once the stream ended on an op boundary with the whole target written
+  bool complete() const { return !failed_ && state_ == OP && written_ == targetLength_; }
+  bool failed() const { return failed_; }
+  uint32_t written() const { return written_; }
+
+ private:
+  enum State : uint8_t { OP, ARGS, LITERAL };
+
+  bool emit(const uint8_t *data, size_t len) {
+    if (len > targetLength_ - written_ || !sink_.write(data, len)) return false;
+    written_ += len;
+    return true;
+  }
+
+  bool fail() {
+    failed_ = true;
+    return false;
+  }
+
+  Sink &sink_;
+  const uint8_t *base_ = nullptr;
+  uint32_t baseLength_ = 0;
+  uint32_t targetLength_ = 0;
+  uint32_t written_ = 0;
+  uint32_t remaining_ = 0;
+  State state_ = OP;
+  uint8_t op_ = 0;
+  uint8_t args_[6];
+  uint8_t argPos_ = 0;
+  uint8_t argLen_ = 0;
+  bool failed_ = false;
+};
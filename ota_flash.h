@@ -0,0 +1,236 @@
+/**
+ * Firmware image staging and activation in the RA4M1 code flash (UNO R4).
+ *
+ *   0x00000 – 0x03FFF   Arduino bootloader (never touched)
+ *   0x04000 – 0x1FFFF   running sketch, at most OTA_SLOT_SIZE (112 KB)
+ *   0x20000 – 0x3FFFF   staging slot for the rebuilt image
+ *
+ * OtaStaging is the sink behind DeltaApplier: the rebuilt image is hashed as it
+ * streams through and programmed into the staging slot in OTA_BUFFER_SIZE
+ * pieces, each read back and compared, erasing 2 KB blocks as they are reached.
+ *
+ * The RA4M1 has one code flash bank, so there is no hardware bank swap.
+ * activate() copies the verified staging slot over the sketch from a routine
+ * in RAM, with interrupts off, and then resets. That takes about a second for a
+ * full slot. A power cut during the copy leaves a sketch that must be reflashed
+ * over USB, but the bootloader and the staged image both survive it.
+ *
+ * Code flash can only be programmed from RAM. Staging uses the core's flash_lp
+ * driver built with FLASH_LP_CFG_CODE_FLASH_PROGRAMMING_ENABLE, which runs each
+ * operation from .code_in_ram and returns to its caller in flash afterwards.
+ * The copy cannot: the driver's entry points live in the sketch it overwrites,
+ * so activate() drives the flash sequencer (FACI_LP) registers itself. Other
+ * boards get a stub that refuses updates.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include "ota_delta.h"
+
+#define OTA_APP_ADDR      0x00004000UL
+#define OTA_STAGING_ADDR  0x00020000UL
+#define OTA_SLOT_SIZE     (OTA_STAGING_ADDR - OTA_APP_ADDR)
+#define OTA_BLOCK_SIZE    2048                    // Code flash erase unit
+#define OTA_WRITE_SIZE       8                    // Code flash program unit
+#define OTA_BUFFER_SIZE    256                    // Bytes programmed per flash call
+
+#if defined(ARDUINO_ARCH_RENESAS_UNO)
+#include "r_flash_lp.h"
+
+// FACI_LP sequencer commands and timings (RA4M1 hardware manual, as used by r_flash_lp)
+#define FACI_FENTRYR_CODE_PE    0xAA01            // Code flash P/E mode
+#define FACI_FENTRYR_READ       0xAA00
+#define FACI_FPR_UNLOCK           0xA5            // Precedes each FPMCR write sequence
+#define FACI_FPMCR_DISCHARGE1     0x12
+#define FACI_FPMCR_DISCHARGE2     0x92
+#define FACI_FPMCR_CODE_PE        0x82
+#define FACI_FPMCR_READ           0x08
+#define FACI_FCR_PROGRAM          0x81            // OPST | program 64 bits
+#define FACI_FCR_ERASE            0x84            // OPST | block erase
+#define FACI_FSTATR1_FRDY         0x40
+#define FACI_T_DIS_US                2            // Discharge settling
+#define FACI_T_MS_US                 5            // Mode setup
+#define FACI_LOOPS_PER_US           12            // Delay loop: >= 4 cycles per turn at 48 MHz
+
+class OtaStaging {
+ public:
+  /**
+   * Prepares to receive an image of the given length.
+   */
+  bool begin(uint32_t length) {
+    if (length > OTA_SLOT_SIZE) return false;
+    if (!open_) {
+      static flash_cfg_t cfg;
+      cfg.data_flash_bgo = false;
+      cfg.p_callback = nullptr;
+      cfg.irq = FSP_INVALID_VECTOR;
+      cfg.err_irq = FSP_INVALID_VECTOR;
+      open_ = R_FLASH_LP_Open(&ctrl_, &cfg) == FSP_SUCCESS;
+      if (!open_) return false;
+    }
+    length_ = length;
+    written_ = 0;
+    programmed_ = 0;
+    fill_ = 0;
+    sha_.reset();
+    return true;
+  }
+
+  bool write(const uint8_t *data, size_t len) {
+    if (len > length_ - written_) return false;
+    sha_.update(data, len);
+    written_ += len;
+    while (len) {
+      size_t take = OTA_BUFFER_SIZE - fill_ < len ? OTA_BUFFER_SIZE - fill_ : len;
+      memcpy(buffer_ + fill_, data, take);
+      fill_ += take;
+      data += take;
+      len -= take;
+      if (fill_ == OTA_BUFFER_SIZE && !program()) return false;
+    }
+    return true;
+  }
+
+  /**
+   * Programs the tail and returns the digest of everything written.
+   */
+  bool finish(uint8_t digest[32]) {
+    if (written_ != length_ || (fill_ && !program())) return false;
+    sha_.finish(digest);
+    return true;
+  }
+
+  bool canActivate() const { return open_ && length_ && written_ == length_; }
+
+  /**
+   * Copies the staged image over the running sketch and resets. Never returns.
+   */
+  void activate() {
+    uint8_t pcka = (uint8_t)(R_FSP_SystemClockHzGet(FSP_PRIV_CLOCK_FCLK) / 1000000UL - 1);
+    install(length_, pcka, buffer_);
+  }
+
+ private:
+  bool program() {
+    uint32_t offset = programmed_;
+    uint32_t address = OTA_STAGING_ADDR + offset;
+    size_t bytes = (fill_ + OTA_WRITE_SIZE - 1) & ~(OTA_WRITE_SIZE - 1);
+    memset(buffer_ + fill_, 0xFF, bytes - fill_);
+
+    __disable_irq();                          // Vectors and ISRs live in code flash
+    bool ok = (offset % OTA_BLOCK_SIZE != 0 || R_FLASH_LP_Erase(&ctrl_, address, 1) == FSP_SUCCESS) &&
+              R_FLASH_LP_Write(&ctrl_, (uint32_t)buffer_, address, bytes) == FSP_SUCCESS;
+    __enable_irq();
+
+    ok = ok && memcmp((const void *)address, buffer_, bytes) == 0;
+    programmed_ += fill_;
+    fill_ = 0;
+    return ok;
+  }
+
+  // Runs from RAM: once the first sketch block is erased nothing in code flash
+  // may execute. Nothing in the copy loop touches code flash: it makes no calls
+  // (the sequencer helpers below are forced inline), its constants sit in its
+  // own literal pool, and the reset is inline. The staging slot is only read as
+  // data, in read mode, between P/E sessions. A failed erase or write cannot be
+  // reported from here; it leaves a sketch to reflash over USB, like a power cut.
+  __attribute__((section(".code_in_ram"), noinline, noreturn))
+  static void install(uint32_t length, uint8_t pcka, uint8_t *scratch) {
+    __disable_irq();
+    for (uint32_t offset = 0; offset < length; offset += OTA_BUFFER_SIZE) {
+      const volatile uint8_t *src = (const volatile uint8_t *)(OTA_STAGING_ADDR + offset);
+      for (uint32_t i = 0; i < OTA_BUFFER_SIZE; i++) scratch[i] = src[i];
+      enterCodeFlashPe(pcka);
+      if (offset % OTA_BLOCK_SIZE == 0) eraseBlock(OTA_APP_ADDR + offset);
+      for (uint32_t i = 0; i < OTA_BUFFER_SIZE; i += OTA_WRITE_SIZE) {
+        programUnit(OTA_APP_ADDR + offset + i, scratch + i);
+      }
+      exitCodeFlashPe();
+    }
+    SCB->AIRCR = (0x5FAUL << SCB_AIRCR_VECTKEY_Pos) | SCB_AIRCR_SYSRESETREQ_Msk;
+    __DSB();
+    for (;;) {}
+  }
+
+  // Sequencer steps for install(), all forced inline into it
+
+  __attribute__((always_inline)) static inline void delayUs(uint32_t us) {
+    for (volatile uint32_t n = us * FACI_LOOPS_PER_US; n; n--) {}
+  }
+
+  __attribute__((always_inline)) static inline void setFlashMode(uint8_t mode) {
+    R_FACI_LP->FPR = FACI_FPR_UNLOCK;
+    R_FACI_LP->FPMCR = mode;
+    R_FACI_LP->FPMCR = (uint8_t)~mode;
+    R_FACI_LP->FPMCR = mode;
+  }
+
+  __attribute__((always_inline)) static inline void enterCodeFlashPe(uint8_t pcka) {
+    R_FACI_LP->FENTRYR = FACI_FENTRYR_CODE_PE;
+    setFlashMode(FACI_FPMCR_DISCHARGE1);
+    delayUs(FACI_T_DIS_US);
+    setFlashMode(FACI_FPMCR_DISCHARGE2);
+    setFlashMode(FACI_FPMCR_CODE_PE);
+    delayUs(FACI_T_MS_US);
+    R_FACI_LP->FISR_b.PCKA = pcka;          // Flash clock, MHz - 1
+  }
+
+  __attribute__((always_inline)) static inline void exitCodeFlashPe() {
+    setFlashMode(FACI_FPMCR_DISCHARGE2);
+    delayUs(FACI_T_DIS_US);
+    setFlashMode(FACI_FPMCR_DISCHARGE1);
+    setFlashMode(FACI_FPMCR_READ);
+    delayUs(FACI_T_MS_US);
+    R_FACI_LP->FENTRYR = FACI_FENTRYR_READ;
+    while (R_FACI_LP->FENTRYR != 0) {}
+  }
+
+  __attribute__((always_inline)) static inline void runCommand(uint8_t command) {
+    R_FACI_LP->FCR = command;
+    while (!(R_FACI_LP->FSTATR1 & FACI_FSTATR1_FRDY)) {}
+    R_FACI_LP->FCR = 0;
+    while (R_FACI_LP->FSTATR1 & FACI_FSTATR1_FRDY) {}
+  }
+
+  __attribute__((always_inline)) static inline void eraseBlock(uint32_t address) {
+    uint32_t last = address + OTA_BLOCK_SIZE - 1;
+    R_FACI_LP->FSARH = (uint16_t)(address >> 16);
+    R_FACI_LP->FSARL = (uint16_t)address;
+    R_FACI_LP->FEARH = (uint16_t)(last >> 16);
+    R_FACI_LP->FEARL = (uint16_t)last;
+    runCommand(FACI_FCR_ERASE);
+  }
+
+  __attribute__((always_inline)) static inline void programUnit(uint32_t address, const uint8_t *data) {
+    R_FACI_LP->FSARH = (uint16_t)(address >> 16);
+    R_FACI_LP->FSARL = (uint16_t)address;
+    R_FACI_LP->FWBL0 = (uint16_t)(data[0] | data[1] << 8);
+    R_FACI_LP->FWBH0 = (uint16_t)(data[2] | data[3] << 8);
+    R_FACI_LP->FWBL1 = (uint16_t)(data[4] | data[5] << 8);
+    R_FACI_LP->FWBH1 = (uint16_t)(data[6] | data[7] << 8);
+    runCommand(FACI_FCR_PROGRAM);
+  }
+
+  flash_lp_instance_ctrl_t ctrl_;
+  bool open_ = false;
+  uint32_t length_ = 0;
+  uint32_t written_ = 0;                    // Bytes received
+  uint32_t programmed_ = 0;                 // Bytes in flash; the rest is in buffer_
+  size_t fill_ = 0;
+  uint8_t buffer_[OTA_BUFFER_SIZE] __attribute__((aligned(4)));
+  Sha256 sha_;
+};
+
+#else
+
+// No staging support on this board: every update is refused at MSG_OTA_BEGIN
+class OtaStaging {
+ public:
+  bool begin(uint32_t) { return false; }
+  bool write(const uint8_t *, size_t) { return false; }
+  bool finish(uint8_t *) { return false; }
+  bool canActivate() const { return false; }
+  void activate() {}
+};
+
+#endif
@@ -0,0 +1,342 @@
+/**
+ * Binary control/telemetry protocol shared by the controller sketch and host tools.
+ *
+ * Every message travels as one COBS-encoded frame between zero delimiters:
+ *
+ *   0x00 | COBS( type | seq | payload[0..PROTO_MAX_PAYLOAD] | crc16 ) | 0x00
+ *
+ *  - type    : MsgType
+ *  - seq     : sender's rolling counter; replies echo the request's seq
+ *  - crc16   : CRC-16/CCITT-FALSE over type..payload, little-endian
+ *
+ * The leading delimiter lets a receiver resynchronize after line noise or stray
+ * text output. All multi-byte fields are little-endian (native on both the
+ * Cortex-M controller and x86/ARM hosts), and nothing here allocates.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define PROTO_MAX_PAYLOAD   240                       // Bytes of payload per frame
+#define PROTO_MAX_RAW       (PROTO_MAX_PAYLOAD + 4)   // type + seq + payload + crc
+#define PROTO_MAX_FRAME     (PROTO_MAX_RAW + 1 + 2)   // COBS overhead + two delimiters
+
+// —— Message Types ——
+enum MsgType : uint8_t {
+  MSG_TELEMETRY     = 0x01,   // Controller → host: TelemetryMsg + spot bitmaps + TaskStats[]
+  MSG_JOURNAL_REQ   = 0x10,   // Host → controller: JournalReq
+  MSG_JOURNAL_DATA  = 0x11,   // Controller → host: JournalRecord[]
+  MSG_JOURNAL_END   = 0x12,   // Controller → host: JournalEnd
+  MSG_EXPORT_REQ    = 0x13,   // Host → controller: ExportReq, starts or resumes a bulk export
+  MSG_EXPORT_DATA   = 0x14,   // Controller → host: ExportData + JournalRecord[]
+  MSG_EXPORT_ACK    = 0x15,   // Host → controller: ExportAck (cumulative)
+  MSG_EXPORT_END    = 0x16,   // Controller → host: JournalEnd, everything acknowledged
+  MSG_CONFIG_SET    = 0x20,   // Host → controller: ConfigSet
+  MSG_COMMAND       = 0x30,   // Host → controller: CommandMsg
+  MSG_HISTOGRAM_REQ = 0x40,   // Host → controller: HistogramReq
+  MSG_HISTOGRAM     = 0x41,   // Controller → host: HistogramMsg, echoes the request's seq
+  MSG_OTA_BEGIN     = 0x50,   // Host → controller: DeltaHeader (ota_delta.h)
+  MSG_OTA_DATA      = 0x51,   // Host → controller: OtaData + delta op stream bytes
+  MSG_OTA_END       = 0x52,   // Host → controller: verify the rebuilt image
+  MSG_OTA_ACTIVATE  = 0x53,   // Host → controller: install the verified image and reboot
+  MSG_ACK           = 0x7E,   // Controller → host: AckMsg
+};
+
+enum ConfigKey : uint8_t {
+  CFG_FSR_THRESHOLD = 1,      // index = spot, value = ADC counts
+  CFG_TIER_PRICE    = 2,      // index = tier, value = cents per hour
+  CFG_TELEMETRY_MS  = 3,      // value = telemetry period, 0 = off
+};
+
+enum CommandCode : uint8_t {
+  CMD_PING          = 0,
+  CMD_OPEN_GATE     = 1,
+  CMD_CLOSE_GATE    = 2,
+};
+
+enum AckStatus : uint8_t {
+  ACK_OK            = 0,
+  ACK_BAD_LENGTH    = 1,
+  ACK_BAD_ARGUMENT  = 2,
+  ACK_UNKNOWN       = 3,
+  ACK_BAD_STATE     = 4,      // Not valid at this point of a multi-step exchange
+  ACK_VERIFY_FAILED = 5,
+};
+
+enum LinkState : uint8_t {
+  LINK_OFFLINE      = 0,      // No WiFi association
+  LINK_WIFI         = 1,      // Associated, Blynk not connected
+  LINK_ONLINE       = 2,      // Blynk connected
+};
+
+enum HistogramId : uint8_t {
+  HIST_LOOP         = 0,      // One loop() pass
+  HIST_CLOUD        = 1,      // One Blynk.run() call
+  HIST_REMOTE       = 2,      // Remote gate command received → servo written
+  HIST_COUNT
+};
+
+enum JournalEvent : uint8_t {
+  EVT_BOOT          = 1,
+  EVT_OCCUPANCY     = 2,      // arg = spot, value = 1 occupied / 0 free
+  EVT_ACCESS_GRANTED = 3,     // value = first two UID bytes
+  EVT_ACCESS_DENIED = 4,      // value = first two UID bytes
+  EVT_GATE_OPEN     = 5,      // arg = source (0 RFID, 1 serial, 2 remote)
+  EVT_GATE_CLOSE    = 6,
+  EVT_PRICE_TIER    = 7,      // arg = tier, value = cents per hour
+  EVT_CONFIG        = 8,      // arg = ConfigKey, value = low 16 bits of the new value
+  EVT_REMOTE_REJECTED = 9,    // arg = 1 bad secret / 2 malformed / 3 rate limited / 4 queue full / 5 no secret set
+  EVT_LINK          = 10,     // arg = new LinkState, value = RSSI (dBm, as int16)
+  EVT_TIME_SYNC     = 11,     // arg = 1 first sync / 0 correction, value = |correction| ms, capped
+  EVT_OTA           = 12,     // arg = 0 begin / 1 verified / 2 failed / 3 activating, value = image KB
+  EVT_PASSAGE       = 13,     // Vehicle detected under the gate arm
+  EVT_SENSOR        = 14,     // arg = spot, value = new SensorState
+  EVT_SESSION       = 15,     // Token in the session QR link, right after its grant:
+                              // arg = 1 high / 0 low half, value = that half
+};
+
+// Event bus channels of the controller (event_bus.h), for per-channel counters
+enum EventChannelId : uint8_t {
+  CHANNEL_OCCUPANCY = 0,
+  CHANNEL_CARD      = 1,
+  CHANNEL_PASSAGE   = 2,
+  CHANNEL_HEALTH    = 3,
+  CHANNEL_COUNT
+};
+
+// —— Payloads ——
+struct __attribute__((packed)) TelemetryMsg {
+  uint32_t uptimeMs;
+  uint32_t journalNextSeq;    // Sequence number the next journal record will get
+  uint16_t priceCents;
+  uint8_t  totalSpots;
+  uint8_t  availableSpots;
+  uint8_t  priceTier;
+  uint8_t  gateOpen;
+  uint32_t loopCyclesAvg;     // loop() cost since the previous telemetry frame
+  uint32_t loopCyclesMax;
+  uint8_t  linkState;         // LinkState
+  int8_t   rssiDbm;           // WiFi signal strength, 0 = unknown
+  uint16_t linkDrops;         // Connection losses since boot
+  uint16_t eventDrops[CHANNEL_COUNT];  // Events lost to a full channel since boot, by EventChannelId
+  uint16_t fsrOverruns;       // FSR sample blocks replaced before they were filtered, since boot
+  uint8_t  taskCount;
+  // Followed by the occupancy bitmap and the unknown-spot bitmap, (totalSpots + 7) / 8
+  // bytes each, then taskCount TaskStats
+};
+
+// FSR health; any state but SENSOR_OK makes the spot unknown
+enum SensorState : uint8_t {
+  SENSOR_OK         = 0,
+  SENSOR_STUCK      = 1,      // Flat at a rail for a day: shorted, or dead while cars came in
+  SENSOR_NOISY      = 2,      // Readings scatter within a block
+  SENSOR_DRIFTING   = 3,      // Average level parked next to the threshold
+};
+
+// Scheduler accounting per task, most urgent first
+struct __attribute__((packed)) TaskStats {
+  uint8_t  priority;
+  uint16_t deadlineMisses;    // Since boot, saturating
+  uint32_t wcetUs;            // Longest single run since boot
+};
+
+// —— Journal Timestamps ——
+// Once the controller clock is synchronized, JournalRecord::stamp counts tenths of
+// a second since JOURNAL_EPOCH_UNIX (2025-01-01 UTC; 31 bits last until late 2031).
+// Before the first sync it holds milliseconds since boot with STAMP_UNSYNCED set.
+#define JOURNAL_EPOCH_UNIX   1735689600UL
+#define STAMP_TICKS_PER_SEC  10
+#define STAMP_UNSYNCED       0x80000000UL
+
+struct __attribute__((packed)) JournalRecord {
+  uint32_t seq;
+  uint32_t stamp;             // See Journal Timestamps
+  uint8_t  type;              // JournalEvent
+  uint8_t  arg;
+  uint16_t value;
+};
+
+struct __attribute__((packed)) JournalReq {
+  uint32_t fromSeq;           // First record wanted; older records are skipped
+};
+
+struct __attribute__((packed)) JournalEnd {
+  uint32_t nextSeq;           // One past the last record sent
+};
+
+// Journal seqs restart at 0 on every boot, so a resume point is only meaningful
+// together with the boot it came from.
+struct __attribute__((packed)) ExportReq {
+  uint32_t bootId;            // Boot the resume point belongs to; 0 = none
+  uint32_t fromSeq;           // First record wanted (resume point)
+  uint8_t  window;            // Unacknowledged data frames allowed in flight
+};
+
+struct __attribute__((packed)) ExportData {
+  uint32_t bootId;            // Random per controller boot, never 0
+  uint32_t oldestSeq;         // Oldest record the controller still holds
+  // Followed by consecutive JournalRecords
+};
+
+struct __attribute__((packed)) ExportAck {
+  uint32_t nextSeq;           // Every record below this has been received in order
+};
+
+struct __attribute__((packed)) ConfigSet {
+  uint8_t  key;               // ConfigKey
+  uint8_t  index;
+  int32_t  value;
+};
+
+struct __attribute__((packed)) CommandMsg {
+  uint8_t  code;              // CommandCode
+  uint8_t  arg;
+};
+
+struct __attribute__((packed)) OtaData {
+  uint32_t offset;            // Position of the following bytes in the op stream
+};
+
+struct __attribute__((packed)) AckMsg {
+  uint8_t  type;              // Type of the acknowledged message
+  uint8_t  status;            // AckStatus
+};
+
+// Bucket i counts samples of [2^i, 2^(i+1)) µs; bucket 0 includes 0 and the last is open-ended
+#define HISTOGRAM_BUCKETS  16
+
+struct __attribute__((packed)) HistogramReq {
+  uint8_t  id;                // HistogramId
+  uint8_t  reset;             // Non-zero clears the histogram after reporting it
+};
+
+struct __attribute__((packed)) HistogramMsg {
+  uint8_t  id;
+  uint32_t maxUs;             // Largest sample since the last reset
+  uint32_t buckets[HISTOGRAM_BUCKETS];
+};
+
+#define JOURNAL_RECORDS_PER_FRAME  (PROTO_MAX_PAYLOAD / sizeof(JournalRecord))
+#define EXPORT_RECORDS_PER_FRAME   ((PROTO_MAX_PAYLOAD - sizeof(ExportData)) / sizeof(JournalRecord))
+
+// —— CRC-16/CCITT-FALSE ——
+inline uint16_t crc16Update(uint16_t crc, uint8_t b) {
+  crc ^= (uint16_t)b << 8;
+  for (uint8_t i = 0; i < 8; i++) {
+    crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+  }
+  return crc;
+}
+
+inline uint16_t crc16(const uint8_t *data, size_t len, uint16_t crc = 0xFFFF) {
+  while (len--) crc = crc16Update(crc, *data++);
+  return crc;
+}
+
+/**
+ * Builds a complete wire frame (delimiters included) into out, which must hold
+ * PROTO_MAX_FRAME bytes. Returns the frame length, or 0 if the payload is too big.
+ */
+inline size_t buildFrame(uint8_t type, uint8_t seq, const void *payload, size_t len, uint8_t *out) {
+  if (len > PROTO_MAX_PAYLOAD) return 0;
+  uint8_t raw[PROTO_MAX_RAW];
+  raw[0] = type;
+  raw[1] = seq;
+  if (len) memcpy(raw + 2, payload, len);
+  uint16_t crc = crc16(raw, len + 2);
+  raw[len + 2] = crc & 0xFF;
+  raw[len + 3] = crc >> 8;
+
+  // COBS: each code byte counts the bytes up to and including the next zero
+  size_t rawLen = len + 4;
+  size_t codeIdx = 1, o = 2;
+  uint8_t code = 1;
+  out[0] = 0;
+  for (size_t i = 0; i < rawLen; i++) {
+    if (raw[i] == 0) {
+      out[codeIdx] = code;
+      codeIdx = o++;
+      code = 1;
+    } else {
+      out[o++] = raw[i];
+      if (++code == 0xFF) {
+        out[codeIdx] = code;
+        codeIdx = o++;
+        code = 1;
+      }
+    }
+  }
+  out[codeIdx] = code;
+  out[o++] = 0;
+  return o;
+}
+
+/**
+ * Incremental frame decoder: feed bytes one at a time as they arrive. When feed()
+ * returns true, type()/seq()/payload()/length() describe a CRC-checked frame that
+ * stays valid until the next non-delimiter byte is fed.
+ */
+class FrameDecoder {
+ public:
+  bool feed(uint8_t b) {
+    if (b == 0) {
+      bool ok = finish();
+      len_ = 0;
+      remaining_ = 0;
+      lastCode_ = 0;
+      overflow_ = false;
+      return ok;
+    }
+    if (overflow_) return false;
+    if (remaining_ == 0) {            // b is a COBS code byte
+      if (lastCode_ != 0 && lastCode_ != 0xFF && !push(0)) return false;
+      lastCode_ = b;
+      remaining_ = b - 1;
+    } else {
+      push(b);
+      remaining_--;
+    }
+    return false;
+  }
+
+  uint8_t type() const { return buf_[0]; }
+  uint8_t seq() const { return buf_[1]; }
+  const uint8_t *payload() const { return buf_ + 2; }
+  size_t length() const { return frameLen_; }
+  uint32_t errors() const { return errors_; }
+
+ private:
+  bool push(uint8_t b) {
+    if (len_ >= PROTO_MAX_RAW) {
+      overflow_ = true;
+      return false;
+    }
+    buf_[len_++] = b;
+    return true;
+  }
+
+  bool finish() {
+    if (len_ == 0 && lastCode_ == 0) return false;   // Back-to-back delimiters
+    if (overflow_ || remaining_ != 0 || len_ < 4) {
+      errors_++;
+      return false;
+    }
+    uint16_t crc = buf_[len_ - 2] | (uint16_t)buf_[len_ - 1] << 8;
+    if (crc16(buf_, len_ - 2) != crc) {
+      errors_++;
+      return false;
+    }
+    frameLen_ = len_ - 4;
+    return true;
+  }
+
+  uint8_t buf_[PROTO_MAX_RAW];
+  size_t len_ = 0;
+  size_t frameLen_ = 0;
+  uint8_t remaining_ = 0;
+  uint8_t lastCode_ = 0;
+  bool overflow_ = false;
+  uint32_t errors_ = 0;
+};
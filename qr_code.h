@@ -0,0 +1,228 @@
+/**
+ * Fixed-size QR encoder for short links on the OLED.
+ *
+ * Always emits version 2 (25×25 modules), error correction level L, byte mode and
+ * mask pattern 0, so both encode time and RAM are constant: 79 bytes of modules
+ * plus ~60 bytes of stack while encoding, no tables and no heap. That fits payloads
+ * of up to QR_MAX_PAYLOAD bytes, enough for a short URL with a session token.
+ * A fixed mask is legal per ISO/IEC 18004; it only skips the penalty search.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#define QR_SIZE          25                 // Modules per side (version 2)
+#define QR_DATA_CODEWORDS 34                // Version 2-L
+#define QR_ECC_CODEWORDS 10
+#define QR_MAX_PAYLOAD   32                 // Byte-mode capacity of 2-L
+// Deliberate deviation: ISO/IEC 18004 asks for a 4-module quiet zone, but with
+// it the 33-module code outgrows both panels at their layout's scale (66 px at
+// 2× on 64 rows, 33 px at 1× on 32). Phone scanners tolerate the narrower border.
+#define QR_QUIET_ZONE     2                 // Light border, in modules
+
+class QrCode {
+ public:
+  /**
+   * Encodes text into the module matrix. Returns false if it does not fit;
+   * re-encoding the payload already held is skipped.
+   */
+  bool encode(const char *text) {
+    size_t len = strlen(text);
+    if (len > QR_MAX_PAYLOAD) return false;
+    if (valid_ && strcmp(text, payload_) == 0) return true;
+
+    uint8_t codewords[QR_DATA_CODEWORDS + QR_ECC_CODEWORDS];
+    buildDataCodewords(text, len, codewords);
+    appendEcc(codewords);
+
+    memset(modules_, 0, sizeof(modules_));
+    drawFunctionPatterns();
+    drawCodewords(codewords);
+    drawFormatBits();
+
+    memcpy(payload_, text, len + 1);
+    valid_ = true;
+    return true;
+  }
+
+  bool valid() const { return valid_; }
+
+  bool module(uint8_t x, uint8_t y) const {
+    uint16_t i = y * QR_SIZE + x;
+    return modules_[i >> 3] & (1 << (i & 7));
+  }
+
+  /**
+   * Draws the code, quiet zone included, into a page-organized framebuffer
+   * (bit 0 = top row of each 8-pixel page) as lit background with dark modules.
+   * scale must be 1 or 2 and y a multiple of scale, so every module is a single
+   * masked byte operation per pixel column.
+   */
+  void blit(uint8_t *buffer, uint16_t width, int16_t x, int16_t y, uint8_t scale) const {
+    uint16_t side = (QR_SIZE + 2 * QR_QUIET_ZONE) * scale;
+    for (uint16_t row = 0; row < side; row++) {
+      uint8_t *dst = buffer + ((y + row) >> 3) * width + x;
+      uint8_t bit = 1 << ((y + row) & 7);
+      for (uint16_t col = 0; col < side; col++) dst[col] |= bit;
+    }
+
+    int16_t ox = x + QR_QUIET_ZONE * scale, oy = y + QR_QUIET_ZONE * scale;
+    uint8_t cellMask = (1 << scale) - 1;
+    for (uint8_t my = 0; my < QR_SIZE; my++) {
+      int16_t py = oy + my * scale;
+      uint8_t *dst = buffer + (py >> 3) * width + ox;
+      uint8_t clear = ~(cellMask << (py & 7));
+      for (uint8_t mx = 0; mx < QR_SIZE; mx++) {
+        if (!module(mx, my)) continue;
+        for (uint8_t s = 0; s < scale; s++) dst[mx * scale + s] &= clear;
+      }
+    }
+  }
+
+ private:
+  void set(uint8_t x, uint8_t y, bool dark) {
+    uint16_t i = y * QR_SIZE + x;
+    if (dark) modules_[i >> 3] |= 1 << (i & 7);
+    else modules_[i >> 3] &= ~(1 << (i & 7));
+  }
+
+  // Finders with separators and format areas, timing lines and the single
+  // alignment pattern of version 2
+  static bool isFunction(uint8_t x, uint8_t y) {
+    if (x < 9 && y < 9) return true;
+    if (x >= QR_SIZE - 8 && y < 9) return true;
+    if (x < 9 && y >= QR_SIZE - 8) return true;
+    if (x == 6 || y == 6) return true;
+    return x >= 16 && x <= 20 && y >= 16 && y <= 20;
+  }
+
+  static void buildDataCodewords(const char *text, size_t len, uint8_t *out) {
+    memset(out, 0, QR_DATA_CODEWORDS);
+    uint16_t bit = 0;
+    auto put = [&](uint16_t value, uint8_t bits) {
+      while (bits--) {
+        if ((value >> bits) & 1) out[bit >> 3] |= 0x80 >> (bit & 7);
+        bit++;
+      }
+    };
+    put(0x4, 4);                            // Byte mode
+    put(len, 8);                            // Character count (versions 1-9)
+    for (size_t i = 0; i < len; i++) put((uint8_t)text[i], 8);
+
+    // Terminator of up to four zero bits, then byte-align (already zero)
+    bit += 4;
+    uint8_t used = (bit + 7) >> 3;
+    if (used > QR_DATA_CODEWORDS) used = QR_DATA_CODEWORDS;
+    for (uint8_t i = used, pad = 0xEC; i < QR_DATA_CODEWORDS; i++, pad ^= 0xEC ^ 0x11) out[i] = pad;
+  }
+
+  // GF(2^8) multiply modulo x^8 + x^4 + x^3 + x^2 + 1
+  static uint8_t gfMul(uint8_t a, uint8_t b) {
+    uint8_t z = 0;
+    for (int8_t i = 7; i >= 0; i--) {
+      z = (z << 1) ^ ((z >> 7) * 0x1D);
+      if ((b >> i) & 1) z ^= a;
+    }
+    return z;
+  }
+
+  static void appendEcc(uint8_t *codewords) {
+    // Generator polynomial (x - α^0)(x - α^1)...(x - α^9), leading 1 implied
+    uint8_t gen[QR_ECC_CODEWORDS] = { 0 };
+    gen[QR_ECC_CODEWORDS - 1] = 1;
+    uint8_t root = 1;
+    for (uint8_t i = 0; i < QR_ECC_CODEWORDS; i++) {
+      for (uint8_t j = 0; j < QR_ECC_CODEWORDS; j++) {
+        gen[j] = gfMul(gen[j], root);
+        if (j + 1 < QR_ECC_CODEWORDS) gen[j] ^= gen[j + 1];
+      }
+      root = gfMul(root, 0x02);
+    }
+
+    uint8_t *ecc = codewords + QR_DATA_CODEWORDS;
+    memset(ecc, 0, QR_ECC_CODEWORDS);
+    for (uint8_t i = 0; i < QR_DATA_CODEWORDS; i++) {
+      uint8_t factor = codewords[i] ^ ecc[0];
+      memmove(ecc, ecc + 1, QR_ECC_CODEWORDS - 1);
+      ecc[QR_ECC_CODEWORDS - 1] = 0;
+      for (uint8_t j = 0; j < QR_ECC_CODEWORDS; j++) ecc[j] ^= gfMul(gen[j], factor);
+    }
+  }
+
+  void drawFinder(uint8_t cx, uint8_t cy) {
+    for (int8_t dy = -4; dy <= 4; dy++) {
+      for (int8_t dx = -4; dx <= 4; dx++) {
+        int8_t x = cx + dx, y = cy + dy;
+        if (x < 0 || x >= QR_SIZE || y < 0 || y >= QR_SIZE) continue;
+        uint8_t dist = ring(dx, dy);
+        set(x, y, dist != 2 && dist != 4);
+      }
+    }
+  }
+
+  void drawFunctionPatterns() {
+    for (uint8_t i = 8; i < QR_SIZE - 8; i++) {
+      set(6, i, i % 2 == 0);
+      set(i, 6, i % 2 == 0);
+    }
+    drawFinder(3, 3);
+    drawFinder(QR_SIZE - 4, 3);
+    drawFinder(3, QR_SIZE - 4);
+    for (int8_t dy = -2; dy <= 2; dy++) {
+      for (int8_t dx = -2; dx <= 2; dx++) {
+        set(18 + dx, 18 + dy, ring(dx, dy) != 1);
+      }
+    }
+  }
+
+  // Zigzag placement from the bottom-right corner, two columns at a time,
+  // skipping the vertical timing line; mask 0 flips modules where (x + y) is even
+  void drawCodewords(const uint8_t *codewords) {
+    uint16_t i = 0;
+    const uint16_t totalBits = (QR_DATA_CODEWORDS + QR_ECC_CODEWORDS) * 8;
+    for (int8_t right = QR_SIZE - 1; right >= 1; right -= 2) {
+      if (right == 6) right = 5;
+      bool upward = ((right + 1) & 2) == 0;
+      for (uint8_t vert = 0; vert < QR_SIZE; vert++) {
+        uint8_t y = upward ? QR_SIZE - 1 - vert : vert;
+        for (uint8_t j = 0; j < 2; j++) {
+          uint8_t x = right - j;
+          if (isFunction(x, y)) continue;
+          bool dark = false;
+          if (i < totalBits) dark = (codewords[i >> 3] >> (7 - (i & 7))) & 1;
+          i++;
+          set(x, y, dark ^ ((x + y) % 2 == 0));
+        }
+      }
+    }
+  }
+
+  void drawFormatBits() {
+    // Level L (01) with mask 0, BCH(15,5) protected and XOR-masked
+    uint16_t data = 0x01 << 3 | 0;
+    uint16_t rem = data;
+    for (uint8_t i = 0; i < 10; i++) rem = (rem << 1) ^ ((rem >> 9) * 0x537);
+    uint16_t bits = (data << 10 | rem) ^ 0x5412;
+
+    for (uint8_t i = 0; i <= 5; i++) set(8, i, (bits >> i) & 1);
+    set(8, 7, (bits >> 6) & 1);
+    set(8, 8, (bits >> 7) & 1);
+    set(7, 8, (bits >> 8) & 1);
+    for (uint8_t i = 9; i < 15; i++) set(14 - i, 8, (bits >> i) & 1);
+
+    for (uint8_t i = 0; i < 8; i++) set(QR_SIZE - 1 - i, 8, (bits >> i) & 1);
+    for (uint8_t i = 8; i < 15; i++) set(8, QR_SIZE - 15 + i, (bits >> i) & 1);
+    set(8, QR_SIZE - 8, true);              // Dark module
+  }
+
+  // Chebyshev distance from a pattern's center
+  static uint8_t ring(int8_t dx, int8_t dy) {
+    uint8_t ax = dx < 0 ? -dx : dx, ay = dy < 0 ? -dy : dy;
+    return ax > ay ? ax : ay;
+  }
+
+  uint8_t modules_[(QR_SIZE * QR_SIZE + 7) / 8];
+  char payload_[QR_MAX_PAYLOAD + 1];
+  bool valid_ = false;
+};
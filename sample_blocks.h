@@ -0,0 +1,66 @@
+/**
+ * Double-buffered sample blocks between a sampler and a block filter.
+ *
+ * The producer writes one frame (one sample per channel) at a time into the half
+ * being filled. When that half is full it is handed over as a ready block and
+ * filling continues in the other half, which mirrors the half- and full-transfer
+ * points of a circular DMA transfer. The consumer processes a whole block per
+ * call, so its per-sample overhead is amortized over Frames samples:
+ *
+ *   SampleBlocks<uint16_t, 3, 4> blocks;
+ *   uint16_t *frame = blocks.frame();
+ *   for (int ch = 0; ch < 3; ch++) frame[ch] = sample(ch);
+ *   if (blocks.commit()) {                   // Block boundary
+ *     filter(*blocks.ready());
+ *     blocks.release();
+ *   }
+ *
+ * A block that is still unreleased when the next one completes is replaced and
+ * counted as an overrun. The indices are volatile so that the producer may run
+ * in an interrupt, in which case the consumer must release a block before the
+ * producer starts refilling that half (one block period).
+ */
+#pragma once
+
+#include <stdint.h>
+
+template<class Sample, uint8_t Channels, uint8_t Frames>
+class SampleBlocks {
+  static_assert(Channels && Frames, "Blocks need at least one channel and one frame");
+
+ public:
+  typedef Sample Block[Frames][Channels];
+
+  // Slot for the next frame; fill all Channels samples, then commit()
+  Sample *frame() { return blocks_[fill_][frame_]; }
+
+  /**
+   * Completes the current frame. Returns true when it completed a block,
+   * which ready() then returns until release().
+   */
+  bool commit() {
+    uint8_t next = frame_ + 1;
+    if (next < Frames) {
+      frame_ = next;
+      return false;
+    }
+    frame_ = 0;
+    if (ready_ != NONE) overruns_ = overruns_ + 1;
+    ready_ = fill_;
+    fill_ = fill_ ^ 1;
+    return true;
+  }
+
+  const Block *ready() const { return ready_ == NONE ? nullptr : &blocks_[ready_]; }
+  void release() { ready_ = NONE; }
+  uint16_t overruns() const { return overruns_; }
+
+ private:
+  static const uint8_t NONE = 0xFF;
+
+  Block blocks_[2];
+  volatile uint8_t fill_ = 0;               // Half being written
+  volatile uint8_t frame_ = 0;              // Next frame within it
+  volatile uint8_t ready_ = NONE;           // Half waiting for the consumer
+  volatile uint16_t overruns_ = 0;
+};
@@ -0,0 +1,46 @@
+#!/usr/bin/env python3
+"""
+arduino_prototypes – turns main.c++ into a plain C++ file the way the Arduino
+builder does: #include <Arduino.h> on top and a prototype for every top-level
+function in front of the first definition, so functions may be called before
+they are defined. #line directives keep diagnostics pointing into main.c++.
+
+  arduino_prototypes.py ../main.c++ firmware_main.cpp
+"""
+import re
+import sys
+
+DEFINITION = re.compile(r'^\s*((?:static |inline )?[A-Za-z_][\w:<>]*[\s*&]+)([A-Za-z_]\w*)\(([^;{}]*)\)\s*\{\s*$')
+KEYWORDS = ('if', 'for', 'while', 'switch', 'return', 'else')
+
+
+def prototypes(lines):
+    found, first, depth = [], None, 0
+    for number, line in enumerate(lines):
+        if depth == 0 and not line.lstrip().startswith(('BLYNK_', 'template', '#')):
+            m = DEFINITION.match(line)
+            if m and m.group(2) not in KEYWORDS and not m.group(1).strip().startswith(KEYWORDS):
+                if first is None:
+                    first = number
+                params = re.sub(r'\s*=\s*[^,]+', '', m.group(3))      # Defaults stay on the definition
+                found.append(m.group(1).strip() + ' ' + m.group(2) + '(' + params + ');')
+        depth += line.count('{') - line.count('}')
+    return found, first
+
+
+def main():
+    source, target = sys.argv[1], sys.argv[2]
+    lines = open(source).read().split('\n')
+    found, first = prototypes(lines)
+    if first is None:
+        sys.exit('%s: no function definitions' % source)
+    out = ['#include <Arduino.h>', '#line 1 "%s"' % source]
+    out += lines[:first]
+    out += found
+    out += ['#line %d "%s"' % (first + 1, source)]
+    out += lines[first:]
+    open(target, 'w').write('\n'.join(out))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,57 @@
+/**
+ * Command lines with scenario files.
+ *
+ * An argument @file stands for the words in file, so a scenario (lot options and
+ * faults) can be kept in a file and run by fleet and firmware_bench alike:
+ *
+ *   # bench/rush.scn – evening rush with a flaky ultrasonic sensor
+ *   -t 2 --rate 40 --stay 20
+ *   echo=0.05
+ *
+ * Words are separated by whitespace; # starts a comment that runs to the end of
+ * the line.
+ */
+#pragma once
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+struct Args {
+  std::vector<std::string> words;           // argv[0] first, files expanded
+
+  // False if a scenario file cannot be read; it is then named in error
+  bool load(int argc, char **argv, std::string &error) {
+    words.clear();
+    for (int i = 0; i < argc; i++) {
+      if (i == 0 || argv[i][0] != '@') {
+        words.push_back(argv[i]);
+        continue;
+      }
+      FILE *file = fopen(argv[i] + 1, "r");
+      if (!file) {
+        error = argv[i] + 1;
+        return false;
+      }
+      std::string word;
+      bool comment = false;
+      for (int c; (c = fgetc(file)) != EOF;) {
+        if (c == '\n') comment = false;
+        else if (c == '#') comment = true;
+        if (comment || c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+          if (!word.empty()) words.push_back(word);
+          word.clear();
+        } else {
+          word += (char)c;
+        }
+      }
+      if (!word.empty()) words.push_back(word);
+      fclose(file);
+    }
+    return true;
+  }
+
+  size_t size() const { return words.size(); }
+  const char *operator[](size_t i) const { return words[i].c_str(); }
+};
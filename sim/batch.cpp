@@ -0,0 +1,78 @@
+/**
+ * Batched occupancy kernel (see batch.h).
+ */
+#include "batch.h"
+
+#include "lot.h"
+
+void ControllerBatch::init(uint32_t lanes, uint8_t spots, uint16_t threshold) {
+  lanes_ = lanes;
+  stride_ = (lanes + BATCH_LANE_ALIGN - 1) / BATCH_LANE_ALIGN * BATCH_LANE_ALIGN;
+  spots_ = spots;
+  sums_.assign((size_t)spots * stride_, 0);
+  scans_.assign(stride_, 0);
+  completed_.assign(stride_, 0);
+  threshold_.assign(stride_, threshold);
+  occupied_.assign(stride_, 0);
+  changed_.assign(stride_, 0);
+  levels_.assign((size_t)spots * lanes, 0);
+  sampled_.assign(lanes, 0);
+}
+
+bool ControllerBatch::addScan(const uint16_t *levels, const uint8_t *sampled) {
+  uint32_t lanes = lanes_;
+  for (uint8_t s = 0; s < spots_; s++) {
+    uint32_t *__restrict sum = &sums_[(size_t)s * stride_];
+    const uint16_t *__restrict in = levels + (size_t)s * lanes;
+    for (uint32_t l = 0; l < lanes; l++) sum[l] += in[l] & (0u - sampled[l]);
+  }
+  uint32_t *__restrict scans = scans_.data();
+  uint32_t *__restrict completed = completed_.data();
+  uint32_t *__restrict changed = changed_.data();
+  uint32_t any = 0;
+  for (uint32_t l = 0; l < lanes; l++) {
+    scans[l] += sampled[l];
+    completed[l] = scans[l] == FSR_BLOCK_SCANS;
+    scans[l] &= completed[l] - 1;
+    changed[l] = 0;
+    any |= completed[l];
+  }
+  if (!any) return false;
+
+  uint32_t *__restrict occupied = occupied_.data();
+  const int32_t *__restrict threshold = threshold_.data();
+  for (uint8_t s = 0; s < spots_; s++) {
+    uint32_t *__restrict sum = &sums_[(size_t)s * stride_];
+    for (uint32_t l = 0; l < lanes; l++) {
+      int32_t level = sum[l] / FSR_BLOCK_SCANS;
+      sum[l] &= completed[l] - 1;
+      // Same test as Controller::addScan, as 0/1 arithmetic instead of a branch
+      uint32_t wasOccupied = (occupied[l] >> s) & 1;
+      uint32_t freed = level < threshold[l] - FSR_HYSTERESIS;
+      uint32_t taken = level >= threshold[l] + FSR_HYSTERESIS;
+      uint32_t flip = completed[l] & ((wasOccupied & freed) | ((wasOccupied ^ 1) & taken));
+      occupied[l] ^= flip << s;
+      changed[l] |= flip;
+    }
+  }
+  return true;
+}
+
+void ControllerBatch::advance(Lot *lots, uint32_t untilMs, const FaultPlan &plan) {
+  uint16_t row[SIM_MAX_SPOTS];
+  for (;;) {
+    // Every lot runs to its next scan; the kernel then takes them all at once
+    bool any = false;
+    for (uint32_t l = 0; l < lanes_; l++) {
+      sampled_[l] = lots[l].advanceToScan(untilMs, plan, row);
+      if (!sampled_[l]) continue;
+      any = true;
+      for (uint8_t s = 0; s < spots_; s++) levels_[(size_t)s * lanes_ + l] = row[s];
+    }
+    if (!any) return;
+    addScan(levels_.data(), sampled_.data());
+    for (uint32_t l = 0; l < lanes_; l++) {
+      if (sampled_[l]) lots[l].finishScan(plan, occupied_[l], changed_[l]);
+    }
+  }
+}
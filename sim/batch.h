@@ -0,0 +1,70 @@
+/**
+ * Batched occupancy kernel: the FSR path of many controllers in lockstep.
+ *
+ * ControllerBatch holds the sensing state of many controllers as struct-of-
+ * arrays, one lane per controller: block accumulators spot-major, then scan
+ * count, threshold, occupancy bitmap and change flag per lane. A scan of every
+ * lot is a few loops over contiguous lanes without branches, which the compiler
+ * vectorizes at -O3 (-march=native for AVX2) instead of walking thousands of
+ * Controller objects, each several cache lines apart.
+ *
+ * Lots do not scan at the same simulated times, and over a city window one may
+ * scan more often than another, so each lane counts its own scans: a round adds
+ * the lanes that sampled and completes the blocks of those that reach
+ * FSR_BLOCK_SCANS.
+ *
+ * Lane for lane the result equals Controller::addScan; batch_check runs both on
+ * the same samples and compares every block, and fleet --batch must report
+ * exactly what the scalar run does.
+ *
+ * Only the sensing path is batched. Gate, RFID, display and link logic and their
+ * timers branch per lot and call the Hal on nearly every step, so they stay
+ * scalar: advance() runs each lot's pass up to its scan and finishes it once the
+ * round is through the kernel.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "controller.h"
+
+#define BATCH_LANE_ALIGN  16                // Lanes per row rounded up to this
+
+struct FaultPlan;
+class Lot;
+
+class ControllerBatch {
+ public:
+  void init(uint32_t lanes, uint8_t spots, uint16_t threshold);
+
+  // Adds a scan for every lane with sampled[lane] set; levels are spot-major,
+  // levels[spot * lanes() + lane], and ignored for the other lanes. Returns true
+  // when some lane completed a block; changed() then tells which lanes changed
+  // occupancy, and is false for those that did not complete one.
+  bool addScan(const uint16_t *levels, const uint8_t *sampled);
+
+  // Runs lots[0, lanes()) up to untilMs, scanning through this batch. Lane l is
+  // lots[l], which must have been stepped only this way since Lot::init().
+  void advance(Lot *lots, uint32_t untilMs, const FaultPlan &plan);
+
+  uint32_t lanes() const { return lanes_; }
+  uint8_t spots() const { return spots_; }
+  void setThreshold(uint32_t lane, uint16_t threshold) { threshold_[lane] = threshold; }
+  uint16_t occupiedBits(uint32_t lane) const { return occupied_[lane]; }
+  bool changed(uint32_t lane) const { return changed_[lane]; }
+
+ private:
+  uint32_t lanes_;
+  uint32_t stride_;                         // Row length of sums_
+  uint8_t spots_;
+  std::vector<uint32_t> sums_;              // [spot * stride_ + lane]
+  std::vector<uint32_t> scans_;             // Scans in the lane's current block
+  std::vector<uint32_t> completed_;
+  std::vector<int32_t> threshold_;
+  std::vector<uint32_t> occupied_;
+  std::vector<uint32_t> changed_;
+  std::vector<uint16_t> levels_;            // advance(): the round's samples, spot-major
+  std::vector<uint8_t> sampled_;
+};
@@ -0,0 +1,122 @@
+/**
+ * batch_check – cross-checks ControllerBatch against the scalar Controller and
+ * times both.
+ *
+ *   batch_check [-n lots] [-b blocks] [-s seed] [--spots n]
+ *
+ * Every lot gets its own sample stream: spots that fill and empty at random,
+ * sensor jitter, and a share of spots whose level wanders around the threshold
+ * to exercise the hysteresis. Each scan goes to one Controller per lot and, in
+ * spot-major order, to a ControllerBatch with one lane per lot. After every
+ * block the occupancy bitmaps and change flags must agree lane for lane; the
+ * first difference is printed and the exit status is 1.
+ *
+ * Build: g++ -std=c++17 -O3 -march=native -I.. -o batch_check batch_check.cpp batch.cpp controller.cpp lot.cpp faults.cpp
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <vector>
+
+#include "batch.h"
+#include "controller.h"
+#include "rng.h"
+
+#define CHECK_THRESHOLD      400
+#define CHECK_FREE_LEVEL      40
+#define CHECK_OCCUPIED_LEVEL 780
+#define CHECK_JITTER           6
+#define CHECK_TOGGLE_CHANCE  0.002          // Per spot and scan: a car arrives or leaves
+#define CHECK_WANDER_SHARE   0.1            // Spots hovering around the threshold
+#define CHECK_WANDER_SPAN     40            // ± counts around it
+
+static double nowNs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(int argc, char **argv) {
+  uint32_t lots = 4096, blocks = 2000;
+  uint64_t seed = 1;
+  int spots = 3;
+  for (int i = 1; i < argc; i++) {
+    bool hasValue = i + 1 < argc;
+    if (!strcmp(argv[i], "-n") && hasValue) lots = strtoul(argv[++i], nullptr, 10);
+    else if (!strcmp(argv[i], "-b") && hasValue) blocks = strtoul(argv[++i], nullptr, 10);
+    else if (!strcmp(argv[i], "-s") && hasValue) seed = strtoull(argv[++i], nullptr, 10);
+    else if (!strcmp(argv[i], "--spots") && hasValue) spots = atoi(argv[++i]);
+    else {
+      fprintf(stderr, "usage: %s [-n lots] [-b blocks] [-s seed] [--spots n]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (!lots || spots < 1 || spots > SIM_MAX_SPOTS) {
+    fprintf(stderr, "need at least one lot and 1..%d spots\n", SIM_MAX_SPOTS);
+    return 2;
+  }
+
+  std::vector<Controller> scalar(lots);
+  ControllerBatch batch;
+  batch.init(lots, spots, CHECK_THRESHOLD);
+  std::vector<Rng> rngs(lots);
+  std::vector<uint8_t> truth((size_t)lots * spots), wanders((size_t)lots * spots);
+  for (uint32_t l = 0; l < lots; l++) {
+    scalar[l].init(spots, CHECK_THRESHOLD, false, Rng::seeded(seed, l, STREAM_CONTROLLER));
+    rngs[l] = Rng::seeded(seed, l, STREAM_SENSORS);
+    for (int s = 0; s < spots; s++) wanders[l * spots + s] = rngs[l].chance(CHECK_WANDER_SHARE);
+  }
+
+  std::vector<uint16_t> laneMajor((size_t)lots * spots), spotMajor((size_t)lots * spots);
+  std::vector<uint8_t> scalarChanged(lots), sampled(lots, 1);
+  double scalarNs = 0, batchNs = 0;
+  uint64_t changes = 0;
+  for (uint32_t b = 0; b < blocks; b++) {
+    for (int scan = 0; scan < FSR_BLOCK_SCANS; scan++) {
+      for (uint32_t l = 0; l < lots; l++) {
+        for (int s = 0; s < spots; s++) {
+          size_t i = (size_t)l * spots + s;
+          int level;
+          if (wanders[i]) {
+            level = CHECK_THRESHOLD + rngs[l].between(-CHECK_WANDER_SPAN, CHECK_WANDER_SPAN);
+          } else {
+            if (rngs[l].chance(CHECK_TOGGLE_CHANCE)) truth[i] ^= 1;
+            level = (truth[i] ? CHECK_OCCUPIED_LEVEL : CHECK_FREE_LEVEL) +
+                    rngs[l].between(-CHECK_JITTER, CHECK_JITTER);
+          }
+          laneMajor[i] = level;
+          spotMajor[(size_t)s * lots + l] = level;
+        }
+      }
+
+      double start = nowNs();
+      for (uint32_t l = 0; l < lots; l++) scalarChanged[l] = scalar[l].addScan(&laneMajor[(size_t)l * spots]);
+      double mid = nowNs();
+      bool completed = batch.addScan(spotMajor.data(), sampled.data());
+      batchNs += nowNs() - mid;
+      scalarNs += mid - start;
+
+      if (completed != (scan == FSR_BLOCK_SCANS - 1)) {
+        fprintf(stderr, "block %u scan %d: batch completed a block out of step\n", b, scan);
+        return 1;
+      }
+    }
+    for (uint32_t l = 0; l < lots; l++) {
+      if (scalar[l].occupiedBits() != batch.occupiedBits(l) || scalarChanged[l] != batch.changed(l)) {
+        fprintf(stderr, "block %u lot %u: scalar %04x%s, batch %04x%s\n", b, l, scalar[l].occupiedBits(),
+                scalarChanged[l] ? " changed" : "", batch.occupiedBits(l), batch.changed(l) ? " changed" : "");
+        return 1;
+      }
+      changes += scalarChanged[l];
+    }
+  }
+
+  double lotScans = (double)lots * blocks * FSR_BLOCK_SCANS;
+  printf("%u lots x %d spots, %u blocks: identical, %llu occupancy changes\n", lots, spots, blocks,
+         (unsigned long long)changes);
+  printf("  scalar  %7.2f ns / lot-scan\n", scalarNs / lotScans);
+  printf("  batch   %7.2f ns / lot-scan  (%.1fx)\n", batchNs / lotScans, scalarNs / batchNs);
+  return 0;
+}
@@ -0,0 +1,507 @@
+/**
+ * Arduino API for the firmware build, on top of the simulated lot (see board.h).
+ */
+#include "board.h"
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "lot.h"
+
+#include <Arduino.h>
+#include <Adafruit_GFX.h>
+#include <BlynkSimpleWifi.h>
+#include <MFRC522.h>
+#include <SPI.h>
+#include <Servo.h>
+#include <WiFiS3.h>
+#include <Wire.h>
+
+// Costs of calls the Hal has no model for, µs
+#define COST_ANALOG_READ_FLOATING   20      // Same conversion as an FSR pin
+#define COST_AT_COMMAND             50      // One round trip to the WiFi module
+#define COST_DNS_LOOKUP          30000
+#define COST_DNS_LOOKUP_FAIL   2000000      // WiFiS3 gives up after its AT timeout
+
+#define AUTHORIZED_UID_TAIL  0x4916         // Last two UID bytes of the enrolled card
+
+uint32_t boardCyclesPerBlock = BOARD_CYCLES_PER_BLOCK;
+
+static Hal *hal;
+static uint8_t spotPins;
+static uint64_t detachedUs;                 // Clock while no Hal is attached
+static Rng noise = Rng::seeded(1, 0, STREAM_CONTROLLER);
+
+static uint64_t blocks;
+static uint64_t settledBlocks;
+static uint64_t cycleDebt;                  // Firmware cycles not yet a whole µs
+static uint64_t waitUs;
+static int worldDepth;
+
+// Counts every basic block of code built with -fsanitize-coverage=trace-pc
+extern "C" void __sanitizer_cov_trace_pc() {
+  blocks++;
+}
+
+// Moves the clock forward by the firmware code run since the last call
+static void settle() {
+  cycleDebt += (blocks - settledBlocks) * boardCyclesPerBlock;
+  settledBlocks = blocks;
+  uint64_t us = cycleDebt * 1000000ULL / BOARD_CPU_HZ;
+  cycleDebt -= us * BOARD_CPU_HZ / 1000000ULL;
+  if (hal) hal->nowUs += us;
+  else detachedUs += us;
+}
+
+static uint64_t nowUs() {
+  settle();
+  return hal ? hal->nowUs : detachedUs;
+}
+
+static void spend(uint64_t us) {
+  settle();
+  if (hal) hal->nowUs += us;
+  else detachedUs += us;
+  if (worldDepth == 0) waitUs += us;        // Inside World the whole call is counted
+}
+
+// —— Instruction counting ——
+// A user-space instruction counter for this thread, switched off while the
+// world behind the Hal runs.
+
+static int counterFd = -2;                  // -2 = not opened yet, -1 = unavailable
+
+static int counter() {
+  if (counterFd == -2) {
+    perf_event_attr attr = perf_event_attr();
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    counterFd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    if (counterFd < 0) counterFd = -1;
+  }
+  return counterFd;
+}
+
+// Scope of a call into the simulated world: charges firmware time first, counts
+// the time the call takes as waiting, and keeps the world's instructions out of
+// the count
+struct World {
+  World() : startUs(nowUs()) {
+    if (worldDepth++ == 0 && counter() >= 0) ioctl(counterFd, PERF_EVENT_IOC_DISABLE, 0);
+  }
+  ~World() {
+    if (--worldDepth > 0) return;
+    waitUs += (hal ? hal->nowUs : detachedUs) - startUs;
+    if (counterFd >= 0) ioctl(counterFd, PERF_EVENT_IOC_ENABLE, 0);
+  }
+
+  uint64_t startUs;
+};
+
+bool boardCountsInstructions() {
+  return counter() >= 0;
+}
+
+uint64_t boardInstructions() {
+  uint64_t count = 0;
+  if (counter() < 0 || read(counterFd, &count, sizeof(count)) != sizeof(count)) return 0;
+  return count;
+}
+
+uint64_t boardNowUs() {
+  return nowUs();
+}
+
+uint64_t boardBlocks() {
+  return blocks;
+}
+
+uint64_t boardWaitUs() {
+  return waitUs;
+}
+
+void boardAttach(Hal &attached, uint8_t spots) {
+  settle();
+  hal = &attached;
+  spotPins = spots;
+}
+
+void boardDetach() {
+  settle();
+  if (hal) detachedUs = hal->nowUs;
+  hal = nullptr;
+}
+
+void boardSeed(Rng rng) {
+  noise = rng;
+}
+
+// —— Core ——
+
+HardwareSerial Serial;
+TwoWire Wire;
+SPIClass SPI;
+CWifi WiFi;
+BlynkClass Blynk;
+
+unsigned long millis() {
+  return (unsigned long)(nowUs() / 1000);
+}
+
+unsigned long micros() {
+  return (unsigned long)nowUs();
+}
+
+void delay(unsigned long ms) {
+  spend(ms * 1000ULL);
+}
+
+void delayMicroseconds(unsigned int us) {
+  spend(us);
+}
+
+void pinMode(uint8_t, uint8_t) {}
+
+void digitalWrite(uint8_t, uint8_t) {}
+
+int digitalRead(uint8_t) {
+  return LOW;
+}
+
+int analogRead(uint8_t pin) {
+  World world;
+  if (hal && pin >= A0 && pin < A0 + spotPins) return hal->analogRead(pin - A0);
+  spend(COST_ANALOG_READ_FLOATING);
+  return noise.between(0, 1023);
+}
+
+unsigned long pulseIn(uint8_t, uint8_t, unsigned long timeoutUs) {
+  World world;
+  if (!hal) {
+    spend(timeoutUs);
+    return 0;
+  }
+  return hal->pulseIn((uint32_t)timeoutUs);
+}
+
+void noInterrupts() {}
+
+void interrupts() {}
+
+long random(long howBig) {
+  return howBig > 0 ? (long)(noise.next() % (uint64_t)howBig) : 0;
+}
+
+long random(long howSmall, long howBig) {
+  return howSmall >= howBig ? howSmall : howSmall + random(howBig - howSmall);
+}
+
+void randomSeed(unsigned long seed) {
+  if (seed) noise = Rng::seeded(seed, 0, STREAM_CONTROLLER);
+}
+
+long map(long x, long inMin, long inMax, long outMin, long outMax) {
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+// —— Print ——
+
+size_t Print::write(const uint8_t *bytes, size_t n) {
+  for (size_t i = 0; i < n; i++) write(bytes[i]);
+  return n;
+}
+
+static size_t printUnsigned(Print &out, unsigned long n, int base) {
+  char digits[8 * sizeof(n) + 1];
+  char *p = digits + sizeof(digits);
+  if (base < 2) base = 10;
+  do {
+    int d = n % base;
+    *--p = d < 10 ? '0' + d : 'A' + d - 10;
+    n /= base;
+  } while (n);
+  return out.write((const uint8_t *)p, digits + sizeof(digits) - p);
+}
+
+static size_t printSigned(Print &out, long n, int base) {
+  if (n >= 0 || base != 10) return printUnsigned(out, (unsigned long)n, base);
+  return out.write('-') + printUnsigned(out, 0UL - (unsigned long)n, 10);
+}
+
+size_t Print::print(const __FlashStringHelper *s) { return print(reinterpret_cast<const char *>(s)); }
+size_t Print::print(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+size_t Print::print(char c) { return write((uint8_t)c); }
+size_t Print::print(int n, int base) { return printSigned(*this, n, base); }
+size_t Print::print(unsigned n, int base) { return printUnsigned(*this, n, base); }
+size_t Print::print(long n, int base) { return printSigned(*this, n, base); }
+size_t Print::print(unsigned long n, int base) { return printUnsigned(*this, n, base); }
+
+size_t Print::print(double n, int digits) {
+  char text[32];
+  int len = snprintf(text, sizeof(text), "%.*f", digits, n);
+  return write((const uint8_t *)text, len);
+}
+
+size_t Print::println() { return write('\r') + write('\n'); }
+size_t Print::println(const __FlashStringHelper *s) { return print(s) + println(); }
+size_t Print::println(const char *s) { return print(s) + println(); }
+size_t Print::println(char c) { return print(c) + println(); }
+size_t Print::println(int n, int base) { return print(n, base) + println(); }
+size_t Print::println(unsigned n, int base) { return print(n, base) + println(); }
+size_t Print::println(long n, int base) { return print(n, base) + println(); }
+size_t Print::println(unsigned long n, int base) { return print(n, base) + println(); }
+size_t Print::println(double n, int digits) { return print(n, digits) + println(); }
+
+// —— Serial: USB CDC, so writes only fill a buffer ——
+
+void HardwareSerial::begin(unsigned long) {}
+size_t HardwareSerial::write(uint8_t) { return 1; }
+int HardwareSerial::available() { return 0; }
+int HardwareSerial::read() { return -1; }
+int HardwareSerial::availableForWrite() { return 512; }
+void HardwareSerial::flush() {}
+
+// —— SPI ——
+
+void SPIClass::begin() {}
+
+void SPIClass::beginTransaction(SPISettings settings) {
+  clockHz_ = settings.clockHz;
+}
+
+void SPIClass::endTransaction() {}
+
+uint8_t SPIClass::transfer(uint8_t) {
+  transfer(nullptr, 1);
+  return 0;
+}
+
+void SPIClass::transfer(void *, size_t count) {
+  spend((count * 8 * 1000000ULL + clockHz_ - 1) / clockHz_);
+}
+
+// —— Wire ——
+
+void TwoWire::begin() {}
+
+void TwoWire::setClock(uint32_t) {}
+
+void TwoWire::beginTransmission(uint8_t) {
+  pending_ = 0;
+}
+
+uint8_t TwoWire::endTransmission(bool) {
+  World world;
+  bool acked = !hal || hal->i2cWrite(pending_);
+  pending_ = 0;
+  return acked ? 0 : 2;                     // 2 = NACK on the address
+}
+
+size_t TwoWire::write(uint8_t) {
+  pending_++;
+  return 1;
+}
+
+// —— Servo ——
+
+uint8_t Servo::attach(int) {
+  return 1;
+}
+
+void Servo::write(int angle) {
+  World world;
+  if (hal) hal->setGate(angle < 45);
+}
+
+// —— MFRC522 ——
+
+void MFRC522::PCD_Init() {}
+
+bool MFRC522::PICC_IsNewCardPresent() {
+  World world;
+  uint16_t tag;
+  if (!hal || !hal->readCard(tag)) return false;
+  uint16_t tail = tag == SIM_AUTHORIZED_TAG ? AUTHORIZED_UID_TAIL : 0;
+  uid.size = 4;
+  uid.uidByte[0] = tag >> 8;
+  uid.uidByte[1] = tag & 0xFF;
+  uid.uidByte[2] = tail >> 8;
+  uid.uidByte[3] = tail & 0xFF;
+  presented_ = true;
+  return true;
+}
+
+bool MFRC522::PICC_ReadCardSerial() {
+  bool read = presented_;
+  presented_ = false;
+  return read;
+}
+
+byte MFRC522::PICC_HaltA() {
+  return 0;
+}
+
+// —— Adafruit_GFX ——
+
+void Adafruit_GFX::drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+  for (int16_t i = 0; i < w; i++) drawPixel(x + i, y, color);
+}
+
+void Adafruit_GFX::drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+  for (int16_t i = 0; i < h; i++) drawPixel(x, y + i, color);
+}
+
+void Adafruit_GFX::drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+  drawFastHLine(x, y, w, color);
+  drawFastHLine(x, y + h - 1, w, color);
+  drawFastVLine(x, y, h, color);
+  drawFastVLine(x + w - 1, y, h, color);
+}
+
+void Adafruit_GFX::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+  for (int16_t i = 0; i < w; i++) drawFastVLine(x + i, y, h, color);
+}
+
+void Adafruit_GFX::fillScreen(uint16_t color) {
+  fillRect(0, 0, width_, height_, color);
+}
+
+size_t Adafruit_GFX::write(uint8_t c) {
+  if (c == '\n') {
+    cursorX_ = 0;
+    cursorY_ += 8 * textSize_;
+  } else if (c != '\r') {
+    // 5×7 cell plus spacing, set pixels only, as glcdfont text without a background
+    for (int col = 0; col < 5; col++) {
+      uint8_t bits = (uint8_t)((c * 37 + col * 11) & 0x7F);
+      for (int row = 0; row < 7; row++) {
+        if (!(bits & (1 << row))) continue;
+        if (textSize_ == 1) drawPixel(cursorX_ + col, cursorY_ + row, textColor_);
+        else fillRect(cursorX_ + col * textSize_, cursorY_ + row * textSize_, textSize_, textSize_, textColor_);
+      }
+    }
+    cursorX_ += 6 * textSize_;
+  }
+  return 1;
+}
+
+// —— WiFiS3 ——
+
+int CWifi::begin(const char *, const char *) {
+  World world;
+  if (!hal) return WL_CONNECT_FAILED;
+  hal->wifiBegin();
+  for (uint64_t startUs = hal->nowUs; hal->nowUs - startUs < timeoutMs_ * 1000ULL;) {
+    if (hal->wifiConnected()) return WL_CONNECTED;
+  }
+  return WL_CONNECT_FAILED;
+}
+
+void CWifi::setTimeout(unsigned long timeoutMs) {
+  timeoutMs_ = timeoutMs;
+}
+
+int CWifi::status() {
+  World world;
+  return hal && hal->wifiConnected() ? WL_CONNECTED : WL_DISCONNECTED;
+}
+
+int32_t CWifi::RSSI() {
+  spend(COST_AT_COMMAND);
+  return -60;
+}
+
+int CWifi::disconnect() {
+  spend(COST_AT_COMMAND);
+  return WL_DISCONNECTED;
+}
+
+int CWifi::hostByName(const char *, IPAddress &) {
+  World world;
+  bool up = hal && hal->wifiConnected();
+  spend(up ? COST_DNS_LOOKUP : COST_DNS_LOOKUP_FAIL);
+  return up;
+}
+
+uint8_t WiFiUDP::begin(uint16_t) {
+  spend(COST_AT_COMMAND);
+  return 1;
+}
+
+int WiFiUDP::beginPacket(IPAddress, uint16_t) {
+  spend(COST_AT_COMMAND);
+  return 1;
+}
+
+size_t WiFiUDP::write(const uint8_t *, size_t n) {
+  return n;
+}
+
+int WiFiUDP::endPacket() {
+  spend(COST_AT_COMMAND);
+  return 1;
+}
+
+int WiFiUDP::parsePacket() {
+  spend(COST_AT_COMMAND);
+  return 0;
+}
+
+int WiFiUDP::read(uint8_t *, size_t) {
+  return 0;
+}
+
+void WiFiUDP::stop() {}
+
+// —— Blynk ——
+
+void BlynkClass::config(const char *) {}
+
+bool BlynkClass::connect(unsigned long timeoutMs) {
+  disconnect();
+  connecting_ = true;
+  if (!hal) return false;
+  for (unsigned long start = millis(); !connected_ && millis() - start < timeoutMs;) run();
+  return connected_;
+}
+
+bool BlynkClass::connected() {
+  World world;
+  return connected_ && hal && hal->cloudConnected();
+}
+
+void BlynkClass::disconnect() {
+  connecting_ = opened_ = connected_ = false;
+}
+
+void BlynkClass::run() {
+  {
+    World world;
+    if (connected()) {
+      hal->cloudRun();
+      return;
+    }
+    if (!connecting_ || !hal) return;
+    if (!opened_) {
+      // A failed socket is retried only after 5 s; the caller gives up first
+      opened_ = hal->cloudConnect();
+      connecting_ = opened_;
+      return;
+    }
+    hal->cloudRun();
+    if (!hal->cloudConnected()) return;
+    connecting_ = false;
+    connected_ = true;
+  }
+  BlynkOnConnected();
+}
+
+void BlynkClass::publish() {
+  World world;
+  if (connected()) hal->cloudPublish();
+}
@@ -0,0 +1,41 @@
+/**
+ * The host board the firmware build runs on (see board/Arduino.h).
+ *
+ * board.cpp implements the Arduino API on top of a Hal: every call that touches
+ * hardware becomes the matching Hal call and takes simulated time the way the
+ * reference controller's do. The firmware's own code takes time too: it is built
+ * with -fsanitize-coverage=trace-pc, every basic block it runs counts, and each
+ * block advances the simulated clock by boardCyclesPerBlock cycles at
+ * BOARD_CPU_HZ. That constant stands in for the Cortex-M4's instructions per
+ * block and CPI; calibrate it against the loopCyclesAvg a board reports in its
+ * telemetry.
+ *
+ * Where the kernel allows, board.cpp also counts the host instructions spent in
+ * firmware code, excluding the simulated world behind the Hal.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include "rng.h"
+
+class Hal;
+
+#define BOARD_CPU_HZ          48000000ULL   // F_CPU of the RA4M1
+#define BOARD_CYCLES_PER_BLOCK        6     // Default for boardCyclesPerBlock
+
+extern uint32_t boardCyclesPerBlock;
+
+// Hardware for the calls that follow; spots are the FSRs wired to A0 upwards.
+// Detaching charges the firmware time still owed to the last Hal.
+void boardAttach(Hal &hal, uint8_t spots);
+void boardDetach();
+
+// Noise on unconnected analog pins and the source behind random()
+void boardSeed(Rng rng);
+
+uint64_t boardNowUs();                      // Simulated clock, firmware time charged
+uint64_t boardBlocks();                     // Basic blocks the firmware has run
+uint64_t boardWaitUs();                     // Time spent waiting on hardware
+bool boardCountsInstructions();
+uint64_t boardInstructions();               // Host instructions in firmware code; 0 if not counted
@@ -0,0 +1,41 @@
+/**
+ * Adafruit_GFX stand-in: primitives and text go through drawPixel() the way the
+ * library's do, so the sketch's display code does the same amount of work. The
+ * glyph shapes are placeholders.
+ */
+#pragma once
+
+#include "Arduino.h"
+
+class Adafruit_GFX : public Print {
+ public:
+  Adafruit_GFX(int16_t w, int16_t h) : width_(w), height_(h) {}
+
+  virtual void drawPixel(int16_t x, int16_t y, uint16_t color) = 0;
+  virtual void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color);
+  virtual void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color);
+  virtual void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+  virtual void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+  virtual void fillScreen(uint16_t color);
+
+  void setCursor(int16_t x, int16_t y) { cursorX_ = x; cursorY_ = y; }
+  int16_t getCursorX() const { return cursorX_; }
+  int16_t getCursorY() const { return cursorY_; }
+  void setTextSize(uint8_t size) { textSize_ = size ? size : 1; }
+  void setTextColor(uint16_t color) { textColor_ = color; }
+  void setTextColor(uint16_t color, uint16_t background) { textColor_ = color; (void)background; }
+  void setTextWrap(bool wrap) { (void)wrap; }
+  int16_t width() const { return width_; }
+  int16_t height() const { return height_; }
+
+  size_t write(uint8_t c) override;
+  using Print::write;
+
+ protected:
+  int16_t width_;
+  int16_t height_;
+  int16_t cursorX_ = 0;
+  int16_t cursorY_ = 0;
+  uint8_t textSize_ = 1;
+  uint16_t textColor_ = 1;
+};
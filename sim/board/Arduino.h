@@ -0,0 +1,105 @@
+/**
+ * Arduino core stand-in for the host build of the firmware (firmware_bench.cpp).
+ *
+ * Declares the part of the Arduino API that main.c++ and its headers use. The
+ * definitions live in board.cpp, which routes every call that touches hardware
+ * into the simulated lot's Hal, so the sketch runs unchanged against the same
+ * world, faults and clock as the reference controller.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef uint8_t byte;
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+
+#define HIGH          1
+#define LOW           0
+#define INPUT         0
+#define OUTPUT        1
+#define INPUT_PULLUP  2
+
+#ifndef F_CPU
+#define F_CPU  48000000UL                   // RA4M1, as on the UNO R4
+#endif
+
+enum AnalogPin : uint8_t { A0 = 14, A1, A2, A3, A4, A5 };
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeoutUs = 1000000UL);
+
+void noInterrupts();
+void interrupts();
+
+long random(long howBig);
+long random(long howSmall, long howBig);
+void randomSeed(unsigned long seed);
+long map(long x, long inMin, long inMax, long outMin, long outMax);
+
+template <class T, class L, class H>
+T constrain(T x, L lo, H hi) { return x < (T)lo ? (T)lo : x > (T)hi ? (T)hi : x; }
+
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#define max(a, b) ((a) > (b) ? (a) : (b))
+
+class Print {
+ public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *bytes, size_t n);
+
+  size_t print(const __FlashStringHelper *s);
+  size_t print(const char *s);
+  size_t print(char c);
+  size_t print(int n, int base = 10);
+  size_t print(unsigned n, int base = 10);
+  size_t print(long n, int base = 10);
+  size_t print(unsigned long n, int base = 10);
+  size_t print(double n, int digits = 2);
+
+  size_t println();
+  size_t println(const __FlashStringHelper *s);
+  size_t println(const char *s);
+  size_t println(char c);
+  size_t println(int n, int base = 10);
+  size_t println(unsigned n, int base = 10);
+  size_t println(long n, int base = 10);
+  size_t println(unsigned long n, int base = 10);
+  size_t println(double n, int digits = 2);
+};
+
+class Stream : public Print {
+ public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int availableForWrite() { return 0; }
+};
+
+// The USB serial port; output is discarded, nothing ever arrives
+class HardwareSerial : public Stream {
+ public:
+  void begin(unsigned long baud);
+  size_t write(uint8_t c) override;
+  using Print::write;
+  int available() override;
+  int read() override;
+  int availableForWrite() override;
+  void flush();
+  operator bool() { return true; }
+};
+
+extern HardwareSerial Serial;
@@ -0,0 +1,48 @@
+/**
+ * Blynk stand-in: connection and Blynk.run() time come from the Hal. As in the
+ * library, connect() arms a login that run() carries out: the first call opens
+ * the socket, later ones wait for the server. Remote writes (BLYNK_WRITE
+ * handlers) are never delivered.
+ */
+#pragma once
+
+#include "WiFiS3.h"
+
+enum VirtualPin : uint8_t { V0, V1, V2, V3, V4, V5, V6, V7, V8, V9, V10 };
+
+class BlynkParam {
+ public:
+  const char *asStr() const { return ""; }
+  int asInt() const { return 0; }
+  size_t getLength() const { return 0; }
+};
+
+class BlynkClass {
+ public:
+  void config(const char *auth);
+  bool connect(unsigned long timeoutMs = 3000);
+  bool connected();
+  void disconnect();
+  void run();
+
+  template <class... Values>
+  void virtualWrite(int pin, Values... values) {
+    (void)pin;
+    ((void)values, ...);
+    publish();
+  }
+
+ private:
+  void publish();
+
+  bool connecting_ = false;                 // Login armed
+  bool opened_ = false;                     // ... and its socket open
+  bool connected_ = false;
+};
+
+extern BlynkClass Blynk;
+
+#define BLYNK_WRITE(pin)   void BlynkWidgetWrite##pin(BlynkParam &param)
+#define BLYNK_CONNECTED()  void BlynkOnConnected()
+
+void BlynkOnConnected();                    // Defined by the sketch
@@ -0,0 +1,27 @@
+/**
+ * MFRC522 stand-in: a card poll is one Hal::readCard(). The enrolled card reads
+ * as the UID main.c++ authorizes, any other as its tag followed by zeros.
+ */
+#pragma once
+
+#include "Arduino.h"
+
+class MFRC522 {
+ public:
+  struct Uid {
+    byte size;
+    byte uidByte[10];
+    byte sak;
+  };
+
+  MFRC522(byte ssPin, byte rstPin) { (void)ssPin; (void)rstPin; }
+  void PCD_Init();
+  bool PICC_IsNewCardPresent();
+  bool PICC_ReadCardSerial();
+  byte PICC_HaltA();
+
+  Uid uid = Uid();
+
+ private:
+  bool presented_ = false;
+};
@@ -0,0 +1,29 @@
+/**
+ * SPI stand-in: transfers take the time they take at the configured clock.
+ */
+#pragma once
+
+#include "Arduino.h"
+
+#define MSBFIRST   1
+#define SPI_MODE0  0
+
+struct SPISettings {
+  SPISettings() {}
+  SPISettings(uint32_t clockHz, uint8_t bitOrder, uint8_t mode) : clockHz(clockHz) { (void)bitOrder; (void)mode; }
+  uint32_t clockHz = 4000000;
+};
+
+class SPIClass {
+ public:
+  void begin();
+  void beginTransaction(SPISettings settings);
+  void endTransaction();
+  uint8_t transfer(uint8_t data);
+  void transfer(void *buffer, size_t count);
+
+ private:
+  uint32_t clockHz_ = 4000000;
+};
+
+extern SPIClass SPI;
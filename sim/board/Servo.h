@@ -0,0 +1,12 @@
+/**
+ * Servo stand-in: the gate arm. 0° is open, anything past 45° closed.
+ */
+#pragma once
+
+#include "Arduino.h"
+
+class Servo {
+ public:
+  uint8_t attach(int pin);
+  void write(int angle);
+};
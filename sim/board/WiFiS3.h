@@ -0,0 +1,48 @@
+/**
+ * WiFiS3 stand-in: association and its state come from the Hal. As in the
+ * library, begin() polls the join for up to its timeout (10 s unless set). There
+ * is no NTP server in the simulated world, so time requests go unanswered.
+ */
+#pragma once
+
+#include "Arduino.h"
+
+#define WL_IDLE_STATUS     0
+#define WL_CONNECTED       3
+#define WL_CONNECT_FAILED  4
+#define WL_DISCONNECTED    6
+
+class IPAddress {
+ public:
+  IPAddress() {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : bytes_{ a, b, c, d } {}
+
+ private:
+  uint8_t bytes_[4] = {};
+};
+
+class CWifi {
+ public:
+  int begin(const char *ssid, const char *pass);
+  void setTimeout(unsigned long timeoutMs);
+  int status();
+  int32_t RSSI();
+  int disconnect();
+  int hostByName(const char *host, IPAddress &address);
+
+ private:
+  unsigned long timeoutMs_ = 10000;
+};
+
+extern CWifi WiFi;
+
+class WiFiUDP {
+ public:
+  uint8_t begin(uint16_t port);
+  int beginPacket(IPAddress address, uint16_t port);
+  size_t write(const uint8_t *bytes, size_t n);
+  int endPacket();
+  int parsePacket();
+  int read(uint8_t *bytes, size_t n);
+  void stop();
+};
@@ -0,0 +1,21 @@
+/**
+ * Wire stand-in: each transaction is one Hal::i2cWrite(), which may NACK.
+ */
+#pragma once
+
+#include "Arduino.h"
+
+class TwoWire : public Print {
+ public:
+  void begin();
+  void setClock(uint32_t hz);
+  void beginTransmission(uint8_t address);
+  uint8_t endTransmission(bool stop = true);   // 0 = acknowledged
+  size_t write(uint8_t c) override;
+  using Print::write;
+
+ private:
+  uint16_t pending_ = 0;
+};
+
+extern TwoWire Wire;
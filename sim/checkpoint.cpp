@@ -0,0 +1,88 @@
+/**
+ * Checkpoint encoding (see checkpoint.h).
+ *
+ * Token byte t < 0x80: t + 1 literal bytes follow. t >= 0x80: (t & 0x7F) + 1 zero
+ * bytes. A single zero stays inside a literal run.
+ */
+#include "checkpoint.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <type_traits>
+
+#define RUN_MAX  128
+
+typedef std::vector<uint8_t> Bytes;
+
+static_assert(std::is_trivially_copyable<Lot>::value, "a Lot must stay plain data to be checkpointed");
+
+static void pack(const uint8_t *data, size_t size, Bytes &out) {
+  size_t i = 0;
+  while (i < size) {
+    size_t zeros = 0;
+    while (i + zeros < size && !data[i + zeros] && zeros < RUN_MAX) zeros++;
+    if (zeros >= 2) {
+      out.push_back(0x80 | (zeros - 1));
+      i += zeros;
+      continue;
+    }
+    size_t start = i++;
+    while (i < size && i - start < RUN_MAX && !(data[i] == 0 && i + 1 < size && data[i + 1] == 0)) i++;
+    out.push_back(i - start - 1);
+    out.insert(out.end(), data + start, data + i);
+  }
+}
+
+static bool unpack(const uint8_t *in, size_t inSize, uint8_t *data, size_t size) {
+  size_t i = 0, o = 0;
+  while (i < inSize) {
+    uint8_t token = in[i++];
+    size_t run = (token & 0x7F) + 1;
+    if (o + run > size) return false;
+    if (token & 0x80) {
+      memset(data + o, 0, run);
+    } else {
+      if (i + run > inSize) return false;
+      memcpy(data + o, in + i, run);
+      i += run;
+    }
+    o += run;
+  }
+  return o == size;
+}
+
+bool saveCheckpoint(const char *path, const std::vector<Lot> &lots, uint64_t seed) {
+  Bytes packed;
+  pack((const uint8_t *)lots.data(), lots.size() * sizeof(Lot), packed);
+
+  CheckpointHeader header = {};
+  header.magic = CHECKPOINT_MAGIC;
+  header.version = CHECKPOINT_VERSION;
+  header.lotBytes = sizeof(Lot);
+  header.lots = lots.size();
+  header.seed = seed;
+  header.atMs = lots.empty() ? 0 : lots[0].nowMs();
+  header.packedBytes = packed.size();
+
+  FILE *f = fopen(path, "wb");
+  if (!f) return false;
+  bool ok = fwrite(&header, sizeof(header), 1, f) == 1 && fwrite(packed.data(), 1, packed.size(), f) == packed.size();
+  return fclose(f) == 0 && ok;
+}
+
+bool loadCheckpoint(const char *path, std::vector<Lot> &lots, uint64_t &seed) {
+  FILE *f = fopen(path, "rb");
+  if (!f) return false;
+  CheckpointHeader header;
+  bool ok = fread(&header, sizeof(header), 1, f) == 1 && header.magic == CHECKPOINT_MAGIC &&
+            header.version == CHECKPOINT_VERSION && header.lotBytes == sizeof(Lot);
+  Bytes packed(ok ? header.packedBytes : 0);
+  ok = ok && fread(packed.data(), 1, packed.size(), f) == packed.size();
+  fclose(f);
+  if (!ok) return false;
+
+  lots.resize(header.lots);
+  seed = header.seed;
+  return unpack(packed.data(), packed.size(), (uint8_t *)lots.data(), lots.size() * sizeof(Lot));
+}
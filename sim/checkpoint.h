@@ -0,0 +1,40 @@
+/**
+ * Simulation checkpoints.
+ *
+ * A checkpoint holds every Lot of a run at one instant, byte for byte, after a
+ * header naming the run. A Lot holds no pointers, so its bytes are the whole
+ * world: controller, protothread, RNG streams, cars and event queue. Runs of zero
+ * bytes (free car and event slots, empty histogram buckets) are stored as counts,
+ * which packs a lot into a few hundred bytes.
+ *
+ * The bytes follow this build's layout of Lot, so only a simulator built from the
+ * same sources can read a checkpoint back; the header records sizeof(Lot) and a
+ * format version to reject the rest.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "lot.h"
+
+#define CHECKPOINT_MAGIC    0x54505043      // "CPPT"
+#define CHECKPOINT_VERSION  4
+
+struct CheckpointHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t reserved;
+  uint32_t lotBytes;                        // sizeof(Lot) of the build that wrote it
+  uint32_t lots;
+  uint64_t seed;
+  uint32_t atMs;                            // Simulated time of every lot
+  uint32_t packedBytes;                     // Encoded lots after the header
+};
+
+// False with errno set on an I/O error
+bool saveCheckpoint(const char *path, const std::vector<Lot> &lots, uint64_t seed);
+
+// False if the file cannot be read or is not a checkpoint of this build
+bool loadCheckpoint(const char *path, std::vector<Lot> &lots, uint64_t &seed);
@@ -0,0 +1,210 @@
+/**
+ * city – lots that share a road network, simulated in parallel.
+ *
+ *   city [-n lots] [-t hours] [-s seed] [-j threads] [--spots n] [--rate cars/h]
+ *        [--stay minutes] [--hops n] [--batch] [fault ...]
+ *
+ * A driver who finds a lot full drives to a neighbouring one (road.h) and tries
+ * up to --hops lots (default 3) before giving up. The city runs twice from the
+ * same seed: first with every lot on its own, where such drivers simply leave,
+ * then connected.
+ *
+ * Each lot is a logical process. Cars travel between them as timestamped
+ * CarTransfer messages, and every road takes at least ROAD_MIN_DRIVE_MS, which
+ * is the lookahead: the simulation advances in windows of that length, and a
+ * message sent in one window can only be due in a later one. So every lot runs a
+ * whole window without waiting on anyone. At each window barrier the messages
+ * are handed over, sorted by (arrival, origin lot, origin sequence), which makes
+ * the results identical for any thread count. Lots are split over -j worker
+ * threads instead of one thread each, since a city has thousands of them.
+ * --batch scans each thread's lots through one ControllerBatch (batch.h), with
+ * the same results.
+ *
+ * Build: make city (see Makefile)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "batch.h"
+#include "lot.h"
+#include "results.h"
+#include "road.h"
+
+#define CITY_DEFAULT_HOPS  3
+
+struct Message {
+  uint32_t toLot;
+  uint32_t atMs;                            // Reaches toLot
+  uint32_t fromLot;
+  CarTransfer car;
+
+  bool operator<(const Message &other) const {
+    if (toLot != other.toLot) return toLot < other.toLot;
+    if (atMs != other.atMs) return atMs < other.atMs;
+    if (fromLot != other.fromLot) return fromLot < other.fromLot;
+    return car.seq < other.car.seq;
+  }
+};
+
+class Barrier {
+ public:
+  explicit Barrier(unsigned parties) : parties_(parties) {}
+
+  void wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    unsigned generation = generation_;
+    if (++waiting_ == parties_) {
+      waiting_ = 0;
+      generation_++;
+      released_.notify_all();
+      return;
+    }
+    released_.wait(lock, [&] { return generation != generation_; });
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable released_;
+  unsigned parties_;
+  unsigned waiting_ = 0;
+  unsigned generation_ = 0;
+};
+
+struct CityRun {
+  FleetResult result;
+  uint64_t messages;
+  uint32_t windows;
+  double wallMs;
+};
+
+static double nowMs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static CityRun runCity(const LotConfig &config, const FaultPlan &plan, uint32_t count, uint32_t untilMs,
+                       uint64_t seed, unsigned threads, bool batched) {
+  RoadNetwork roads(count);
+  std::vector<Lot> lots(count);
+  std::vector<std::vector<Message>> sent(threads);
+  std::vector<uint64_t> sentCount(threads);
+  Barrier barrier(threads);
+  CityRun run = CityRun();
+  double startMs = nowMs();
+
+  auto worker = [&](unsigned t) {
+    uint32_t first = (uint64_t)count * t / threads, end = (uint64_t)count * (t + 1) / threads;
+    for (uint32_t i = first; i < end; i++) lots[i].init(config, seed, i);
+    ControllerBatch batch;
+    if (batched) batch.init(end - first, config.spots, config.threshold);
+    std::vector<Message> inbox;
+
+    for (uint32_t windowStart = 0; windowStart < untilMs; windowStart += ROAD_MIN_DRIVE_MS) {
+      uint32_t windowEnd = untilMs - windowStart > ROAD_MIN_DRIVE_MS ? windowStart + ROAD_MIN_DRIVE_MS : untilMs;
+
+      // Every lot runs the window alone; what it sends is due after the window
+      sent[t].clear();
+      if (batched) batch.advance(&lots[first], windowEnd, plan);
+      for (uint32_t i = first; i < end; i++) {
+        Lot &lot = lots[i];
+        if (!batched) lot.advance(windowEnd, plan);
+        for (uint8_t m = 0; m < lot.outboxCount(); m++) {
+          const CarTransfer &car = lot.outbox()[m];
+          uint32_t to = roads.next(i, car.route, car.hops);
+          sent[t].push_back(Message{ to, car.leftMs + roads.driveMs(i, to), i, car });
+        }
+        lot.clearOutbox();
+      }
+      sentCount[t] += sent[t].size();
+      barrier.wait();
+
+      // Collect what is addressed to this thread's lots, in an order that does not
+      // depend on which thread sent it
+      inbox.clear();
+      for (const std::vector<Message> &from : sent) {
+        for (const Message &message : from) {
+          if (message.toLot >= first && message.toLot < end) inbox.push_back(message);
+        }
+      }
+      std::sort(inbox.begin(), inbox.end());
+      for (const Message &message : inbox) lots[message.toLot].receive(message.car, message.atMs);
+      barrier.wait();                       // Senders may clear their lists again
+      if (t == 0) run.windows++;
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (unsigned t = 1; t < threads; t++) workers.emplace_back(worker, t);
+  worker(0);
+  for (std::thread &w : workers) w.join();
+
+  for (const Lot &lot : lots) run.result.add(lot);
+  for (uint64_t n : sentCount) run.messages += n;
+  run.wallMs = nowMs() - startMs;
+  return run;
+}
+
+static void usage(const char *argv0) {
+  fprintf(stderr, "usage: %s [-n lots] [-t hours] [-s seed] [-j threads] [--spots n] [--rate cars/h]\n"
+                  "       [--stay minutes] [--hops n] [--batch] [fault ...]\n", argv0);
+}
+
+int main(int argc, char **argv) {
+  uint32_t count = 256;
+  double hours = 4;
+  uint64_t seed = 1;
+  unsigned threads = std::thread::hardware_concurrency();
+  LotConfig config;
+  config.maxHops = CITY_DEFAULT_HOPS;
+  bool batched = false;
+  FaultPlan plan;
+
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (!strcmp(arg, "-n") && hasValue) count = strtoul(argv[++i], nullptr, 10);
+    else if (!strcmp(arg, "-t") && hasValue) hours = strtod(argv[++i], nullptr);
+    else if (!strcmp(arg, "-s") && hasValue) seed = strtoull(argv[++i], nullptr, 10);
+    else if (!strcmp(arg, "-j") && hasValue) threads = strtoul(argv[++i], nullptr, 10);
+    else if (!strcmp(arg, "--spots") && hasValue) config.spots = atoi(argv[++i]);
+    else if (!strcmp(arg, "--rate") && hasValue) config.arrivalsPerHour = strtod(argv[++i], nullptr);
+    else if (!strcmp(arg, "--stay") && hasValue) config.meanStayMin = strtod(argv[++i], nullptr);
+    else if (!strcmp(arg, "--hops") && hasValue) config.maxHops = atoi(argv[++i]);
+    else if (!strcmp(arg, "--batch")) batched = true;
+    else if (!plan.parse(arg)) {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (!count || hours <= 0 || hours > 1000 || config.spots < 1 || config.spots > SIM_MAX_SPOTS ||
+      config.arrivalsPerHour <= 0 || config.maxHops < 1 || config.maxHops > 16) {
+    usage(argv[0]);
+    return 2;
+  }
+  if (!threads) threads = 1;
+  if (threads > count) threads = count;
+
+  uint32_t untilMs = (uint32_t)(hours * 3600000);
+  LotConfig isolated = config;
+  isolated.maxHops = 0;
+  CityRun alone = runCity(isolated, plan, count, untilMs, seed, threads, batched);
+  CityRun city = runCity(config, plan, count, untilMs, seed, threads, batched);
+
+  printf("%u lots x %.1f h, %u spots, %.1f cars/h, up to %u lots tried, seed %llu\n", count, hours, config.spots,
+         config.arrivalsPerHour, config.maxHops, (unsigned long long)seed);
+  printf("%u windows of %u ms, %llu cars moved between lots, %.0f ms on %u threads\n", city.windows,
+         ROAD_MIN_DRIVE_MS, (unsigned long long)city.messages, city.wallMs, threads);
+  const char *const names[] = { "isolated", "road network" };
+  const FleetResult results[] = { alone.result, city.result };
+  printReport(names, results, 2, count * hours);
+  return 0;
+}
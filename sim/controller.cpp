@@ -0,0 +1,248 @@
+/**
+ * Reference controller (see controller.h). Function for function this follows
+ * main.c++; comments only mark where the simulation differs.
+ */
+#include "controller.h"
+
+#include "lot.h"
+
+void ControllerStats::merge(const ControllerStats &other) {
+  cardsRead += other.cardsRead;
+  cardsDenied += other.cardsDenied;
+  echoTimeouts += other.echoTimeouts;
+  phantomPassages += other.phantomPassages;
+  displayNacks += other.displayNacks;
+  slowCloudRuns += other.slowCloudRuns;
+  linkDrops += other.linkDrops;
+  busyUs += other.busyUs;
+  passMs.merge(other.passMs);
+  cloudStalenessMs.merge(other.cloudStalenessMs);
+}
+
+void Controller::init(uint8_t spots, uint16_t threshold, bool legacyEcho, Rng rng) {
+  *this = Controller();
+  spots_ = spots;
+  threshold_ = threshold;
+  legacyEcho_ = legacyEcho;
+  rng_ = rng;
+  shownAvailable_ = spots;
+  linkBackoffMs_ = LINK_BACKOFF_MIN_MS;
+}
+
+uint64_t Controller::pass(Hal &hal) {
+  uint16_t levels[SIM_MAX_SPOTS];
+  bool changed = beginPass(hal, levels) && addScan(levels);
+  return endPass(hal, occupied_, changed);
+}
+
+bool Controller::beginPass(Hal &hal, uint16_t *levels) {
+  passStartUs_ = hal.nowUs;
+
+  // Same order as the firmware task table
+  nowMs_ = hal.nowMs();
+  pollRfid(hal);
+  nowMs_ = hal.nowMs();
+  gateSequence(hal);
+  nowMs_ = hal.nowMs();
+  if (nowMs_ - lastScanMs_ < FSR_SCAN_MS) return false;
+  lastScanMs_ = nowMs_;
+  for (uint8_t i = 0; i < spots_; i++) levels[i] = hal.analogRead(i);
+  return true;
+}
+
+uint64_t Controller::endPass(Hal &hal, uint16_t occupied, bool changed) {
+  occupied_ = occupied;
+  nowMs_ = hal.nowMs();
+  if (changed) availabilityChanged();
+  if (nowMs_ - lastFrameMs_ >= ANIM_FRAME_MS) {
+    lastFrameMs_ = nowMs_;
+    refreshDisplay(hal);
+  }
+  nowMs_ = hal.nowMs();
+  uint32_t cloudPeriod = cloudBackoffMs_ > CLOUD_PERIOD_MS ? cloudBackoffMs_ : CLOUD_PERIOD_MS;
+  if (nowMs_ - lastCloudRunMs_ >= cloudPeriod) {
+    lastCloudRunMs_ = nowMs_;
+    serviceCloud(hal);
+  }
+
+  uint64_t busyUs = hal.nowUs - passStartUs_;
+  stats.busyUs += busyUs;
+  stats.passMs.add((uint32_t)(busyUs / 1000));
+  return hal.nowUs + SIM_PASS_US;
+}
+
+uint8_t Controller::available() const {
+  return spots_ - __builtin_popcount(occupied_);
+}
+
+void Controller::availabilityChanged() {
+  displayDirty_ = true;
+  if (!cloudDirty_) {
+    cloudDirty_ = true;
+    cloudDirtySinceMs_ = nowMs_;
+  }
+}
+
+bool Controller::addScan(const uint16_t *levels) {
+  for (uint8_t i = 0; i < spots_; i++) blockSums_[i] += levels[i];
+  if (++blockScans_ < FSR_BLOCK_SCANS) return false;
+  blockScans_ = 0;
+
+  bool changed = false;
+  for (uint8_t i = 0; i < spots_; i++) {
+    int level = blockSums_[i] / FSR_BLOCK_SCANS;
+    blockSums_[i] = 0;
+    bool occupied = occupied_ & (1 << i);
+    if (occupied ? level >= threshold_ - FSR_HYSTERESIS
+                 : level < threshold_ + FSR_HYSTERESIS) continue;
+    occupied_ ^= 1 << i;
+    changed = true;
+  }
+  return changed;
+}
+
+void Controller::pollRfid(Hal &hal) {
+  uint16_t tag;
+  if (!hal.readCard(tag)) return;
+  stats.cardsRead++;
+  if (tag == SIM_AUTHORIZED_TAG) {
+    gateOpen_ = true;
+    gateGrant_++;
+    hal.setGate(true);
+  } else {
+    stats.cardsDenied++;
+    displayDirty_ = true;             // ACCESS DENIED banner
+  }
+}
+
+PT_THREAD(Controller::gateSequence(Hal &hal)) {
+  PT_BEGIN(gateThread_);
+  PT_WAIT_UNTIL(gateThread_, gateOpen_);
+  gateThreadGrant_ = gateGrant_;
+  PT_SLEEP(gateThread_, gateTiming.settleMs);
+
+  while (gateOpen_ && !vehicleUnderArm(hal)) {
+    PT_SLEEP(gateThread_, gateTiming.pollMs);
+  }
+  if (!gateOpen_) PT_RESTART(gateThread_);
+
+  gateThread_.timer = nowMs_;
+  PT_WAIT_UNTIL(gateThread_, gateGrant_ != gateThreadGrant_ || nowMs_ - gateThread_.timer >= gateTiming.closeDelayMs);
+  if (gateGrant_ != gateThreadGrant_) PT_RESTART(gateThread_);
+  if (gateOpen_) {
+    gateOpen_ = false;
+    hal.setGate(false);
+  }
+  PT_END(gateThread_);
+}
+
+bool Controller::vehicleUnderArm(Hal &hal) {
+  uint32_t echoUs = hal.pulseIn(legacyEcho_ ? LEGACY_ECHO_TIMEOUT_US : ECHO_TIMEOUT_US);
+  nowMs_ = hal.nowMs();
+  if (!echoUs) {
+    stats.echoTimeouts++;
+    if (!legacyEcho_) return false;
+    stats.phantomPassages++;          // pulseIn() 0 used to read as a vehicle at 0 cm
+    return true;
+  }
+  return echoUs * 0.034 / 2.0 <= PASSAGE_DISTANCE_CM;
+}
+
+void Controller::refreshDisplay(Hal &hal) {
+  if (!displayDirty_) return;
+  if (!hal.displayFlush()) {
+    stats.displayNacks++;             // Still dirty: retried next frame
+    return;
+  }
+  displayDirty_ = false;
+  shownAvailable_ = available();
+}
+
+void Controller::serviceCloud(Hal &hal) {
+  if (!manageLink(hal)) return;
+
+  uint64_t startUs = hal.nowUs;
+  hal.cloudRun();
+  nowMs_ = hal.nowMs();
+  if (hal.nowUs - startUs > CLOUD_BUDGET_US) {
+    stats.slowCloudRuns++;
+    cloudBackoffMs_ = cloudBackoffMs_ ? (cloudBackoffMs_ * 2 < CLOUD_MAX_BACKOFF_MS ? cloudBackoffMs_ * 2
+                                                                                   : CLOUD_MAX_BACKOFF_MS)
+                                      : 2 * CLOUD_PERIOD_MS;
+    return;
+  }
+  cloudBackoffMs_ /= 2;
+
+  if (!cloudDirty_ || !hal.cloudConnected()) return;
+  hal.cloudPublish();
+  nowMs_ = hal.nowMs();
+  stats.cloudStalenessMs.add(nowMs_ - cloudDirtySinceMs_);
+  cloudDirty_ = false;
+}
+
+bool Controller::manageLink(Hal &hal) {
+  if (linkState_ == SIM_LINK_ONLINE) {
+    if (nowMs_ - lastLinkCheckMs_ >= LINK_CHECK_MS) {
+      lastLinkCheckMs_ = nowMs_;
+      if (!hal.wifiConnected()) setLinkState(SIM_LINK_OFFLINE);
+    }
+    if (linkState_ == SIM_LINK_ONLINE && !hal.cloudConnected()) setLinkState(SIM_LINK_WIFI);
+    return linkState_ == SIM_LINK_ONLINE;
+  }
+
+  if (!linkAttempting_) {
+    if ((int32_t)(nowMs_ - linkNextAttemptMs_) < 0 || gateOpen_) return false;
+    if (linkState_ == SIM_LINK_WIFI && !hal.wifiConnected()) {
+      nowMs_ = hal.nowMs();
+      setLinkState(SIM_LINK_OFFLINE);
+      return false;
+    }
+    linkAttempting_ = true;
+    linkAttemptMs_ = lastLinkCheckMs_ = nowMs_;
+    if (linkState_ == SIM_LINK_WIFI) cloudSocket_ = 0;
+    else if (!hal.wifiConnected()) hal.wifiBegin();
+    nowMs_ = hal.nowMs();
+    return false;
+  }
+
+  bool ok;
+  if (linkState_ == SIM_LINK_OFFLINE) {
+    if (nowMs_ - lastLinkCheckMs_ < LINK_POLL_MS) return false;
+    lastLinkCheckMs_ = nowMs_;
+    ok = hal.wifiConnected();
+    nowMs_ = hal.nowMs();
+    if (ok) setLinkState(SIM_LINK_WIFI);
+    else if (nowMs_ - linkAttemptMs_ < WIFI_JOIN_TIMEOUT_MS) return false;
+  } else {
+    // One Blynk.run(): the first opens the socket, later ones wait for the login
+    if (cloudSocket_ == 0) cloudSocket_ = hal.cloudConnect() ? 1 : 2;
+    else if (cloudSocket_ == 1) hal.cloudRun();
+    ok = cloudSocket_ == 1 && hal.cloudConnected();
+    nowMs_ = hal.nowMs();
+    if (ok) setLinkState(SIM_LINK_ONLINE);
+    else if (nowMs_ - linkAttemptMs_ < CLOUD_CONNECT_TIMEOUT_MS) return false;
+  }
+  linkAttempting_ = false;
+  if (ok) {
+    linkBackoffMs_ = LINK_BACKOFF_MIN_MS;
+    linkNextAttemptMs_ = nowMs_;
+  } else {
+    linkNextAttemptMs_ = nowMs_ + rng_.between(linkBackoffMs_ / 2, linkBackoffMs_);
+    linkBackoffMs_ = linkBackoffMs_ * 2 < LINK_BACKOFF_MAX_MS ? linkBackoffMs_ * 2 : LINK_BACKOFF_MAX_MS;
+  }
+  return false;
+}
+
+void Controller::setLinkState(uint8_t state) {
+  if (state < linkState_) {
+    stats.linkDrops++;
+    linkBackoffMs_ = LINK_BACKOFF_MIN_MS;
+    linkNextAttemptMs_ = nowMs_;
+  }
+  if (state == SIM_LINK_ONLINE && !cloudDirty_) {
+    cloudDirty_ = true;               // BLYNK_CONNECTED republishes every pin
+    cloudDirtySinceMs_ = nowMs_;
+  }
+  linkState_ = state;
+  lastLinkCheckMs_ = nowMs_;
+}
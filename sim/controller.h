@@ -0,0 +1,163 @@
+/**
+ * Reference controller for the host simulator.
+ *
+ * A host port of the control logic in main.c++, at the level the simulator can
+ * observe: FSR scans filtered in blocks with hysteresis, RFID admission, the gate
+ * sequence (the same protothread, see coro.h), display refresh, the cloud task
+ * with its back-off, and the connection manager. Constants mirror the firmware.
+ *
+ * Where it differs from main.c++:
+ * - one crossing threshold for every spot (LotConfig::threshold), where the
+ *   firmware keeps per-spot fsrThresholds; the simulated FSRs all share one
+ *   profile, so a spread there would model nothing;
+ * - no sensor health: spots never turn unknown, and the FSR noise fault, which
+ *   can get a spot flagged noisy on the board, only delays detection here;
+ * - no remote commands, NTP, journal, OTA or telemetry beyond what the
+ *   cloud task's timing needs.
+ * firmware_bench runs the sketch itself next to this port and shows where these
+ * differences move the results.
+ *
+ * The controller only touches hardware through a Hal, and every Hal call takes
+ * simulated time the way the real call takes wall time. A blocking call (an
+ * ultrasonic timeout, opening the Blynk socket, a slow Blynk.run()) therefore
+ * delays every other task of the pass, as it does on the board.
+ *
+ * Controller is plain data: copying one copies the controller, and a checkpoint
+ * stores it byte for byte.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include "rng.h"
+#include "stats.h"
+
+class Hal;
+
+// Protothread sleeps use the controller clock
+#define PT_CLOCK() nowMs_
+#include "coro.h"
+
+#define SIM_MAX_SPOTS        16
+
+// —— Mirrored from main.c++ ——
+#define FSR_SCAN_MS          20
+#define FSR_BLOCK_SCANS       2
+#define FSR_HYSTERESIS       20
+#define GATE_SETTLE_MS     2000
+#define GATE_POLL_MS        100
+#define GATE_CLOSE_DELAY_MS 2500
+#define PASSAGE_DISTANCE_CM  11.0
+#define ECHO_TIMEOUT_US   25000
+#define ANIM_FRAME_MS        40
+#define CLOUD_PERIOD_MS      10
+#define CLOUD_BUDGET_US    2000
+#define CLOUD_MAX_BACKOFF_MS 640
+#define LINK_BACKOFF_MIN_MS  500
+#define LINK_BACKOFF_MAX_MS 60000
+#define LINK_CHECK_MS      1000
+#define LINK_POLL_MS        100
+#define WIFI_JOIN_TIMEOUT_MS 10000
+#define CLOUD_CONNECT_TIMEOUT_MS 1500
+
+#define LEGACY_ECHO_TIMEOUT_US  1000000     // pulseIn() default before the timeout fix
+#define SIM_PASS_US             1000        // Idle time between scheduler passes
+#define SIM_AUTHORIZED_TAG      0x030C      // First two UID bytes of the enrolled card
+
+enum SimLinkState : uint8_t { SIM_LINK_OFFLINE, SIM_LINK_WIFI, SIM_LINK_ONLINE };
+
+// Gate timings, variable so scenarios can try others than the firmware's
+struct GateTiming {
+  uint32_t settleMs = GATE_SETTLE_MS;
+  uint32_t pollMs = GATE_POLL_MS;
+  uint32_t closeDelayMs = GATE_CLOSE_DELAY_MS;
+};
+
+struct ControllerStats {
+  uint32_t cardsRead;
+  uint32_t cardsDenied;
+  uint32_t echoTimeouts;
+  uint32_t phantomPassages;           // Missing echo taken for a vehicle (legacy only)
+  uint32_t displayNacks;
+  uint32_t slowCloudRuns;
+  uint32_t linkDrops;
+  uint64_t busyUs;                    // Time spent inside scheduler passes
+  Histogram passMs;                   // Length of each scheduler pass
+  Histogram cloudStalenessMs;         // Availability change → published to Blynk
+
+  void merge(const ControllerStats &other);
+};
+
+class Controller {
+ public:
+  void init(uint8_t spots, uint16_t threshold, bool legacyEcho, Rng rng);
+
+  // Runs one scheduler pass starting at hal.nowUs; returns when the next one starts
+  uint64_t pass(Hal &hal);
+
+  // The same pass in two halves around the FSR scan, for ControllerBatch.
+  // beginPass() runs up to the scan and returns true with the samples in levels,
+  // or false when no scan is due. endPass() takes the occupancy after the scan
+  // and whether it changed, and runs the rest; pass() puts addScan() between.
+  bool beginPass(Hal &hal, uint16_t *levels);
+  uint64_t endPass(Hal &hal, uint16_t occupied, bool changed);
+
+  // Adds one FSR scan (a level per spot) to the current block; true when the
+  // block completed and occupancy changed. ControllerBatch must match this.
+  bool addScan(const uint16_t *levels);
+
+  uint16_t occupiedBits() const { return occupied_; }
+  uint8_t shownAvailable() const { return shownAvailable_; }   // What the OLED says
+  bool gateOpen() const { return gateOpen_; }
+
+  GateTiming gateTiming;
+  ControllerStats stats;
+
+ private:
+  void pollRfid(Hal &hal);
+  PT_THREAD(gateSequence(Hal &hal));
+  bool vehicleUnderArm(Hal &hal);
+  void refreshDisplay(Hal &hal);
+  void serviceCloud(Hal &hal);
+  bool manageLink(Hal &hal);
+  void setLinkState(uint8_t state);
+  void availabilityChanged();
+  uint8_t available() const;
+
+  uint8_t spots_;
+  uint16_t threshold_;
+  bool legacyEcho_;
+  Rng rng_;                           // Reconnect jitter
+  uint32_t nowMs_;
+  uint64_t passStartUs_;
+
+  // Occupancy
+  uint32_t blockSums_[SIM_MAX_SPOTS];
+  uint8_t blockScans_;
+  uint16_t occupied_;
+  uint32_t lastScanMs_;
+
+  // Gate
+  bool gateOpen_;
+  Protothread gateThread_;
+  uint8_t gateGrant_;                 // Bumped by every grant
+  uint8_t gateThreadGrant_;           // ... as of the gate flow's last start
+
+  // Display
+  bool displayDirty_;
+  uint8_t shownAvailable_;
+  uint32_t lastFrameMs_;
+
+  // Cloud and link
+  bool cloudDirty_;
+  uint32_t cloudDirtySinceMs_;
+  uint32_t cloudBackoffMs_;
+  uint32_t lastCloudRunMs_;
+  uint8_t linkState_;
+  uint32_t linkBackoffMs_;
+  uint32_t linkNextAttemptMs_;
+  uint32_t lastLinkCheckMs_;
+  bool linkAttempting_;
+  uint32_t linkAttemptMs_;
+  uint8_t cloudSocket_;               // Blynk library: 0 not opened yet, 1 open, 2 failed
+};
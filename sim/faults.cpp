@@ -0,0 +1,69 @@
+/**
+ * Fault plan parsing and schedules (see faults.h).
+ */
+#include "faults.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *const names[FAULT_KINDS] = {
+  "echo", "fsr-noise", "rfid", "i2c-nack", "wifi-drop", "cloud-latency",
+};
+static const double defaultMagnitude[FAULT_KINDS] = { 0, 150, 0, 0, 30, 800 };
+
+const char *faultName(uint8_t kind) {
+  return kind < FAULT_KINDS ? names[kind] : "?";
+}
+
+bool FaultSpec::activeAt(uint32_t nowMs) const {
+  if (nowMs < startMs || nowMs >= endMs) return false;
+  return !periodMs || (nowMs - startMs) % periodMs < burstMs;
+}
+
+bool FaultPlan::parse(const char *arg) {
+  const char *eq = strchr(arg, '=');
+  if (!eq) return false;
+  int kind = -1;
+  for (int i = 0; i < FAULT_KINDS; i++) {
+    if (strlen(names[i]) == (size_t)(eq - arg) && !strncmp(arg, names[i], eq - arg)) kind = i;
+  }
+  if (kind < 0) return false;
+
+  FaultSpec parsed;
+  char *end;
+  parsed.probability = strtod(eq + 1, &end);
+  if (end == eq + 1 || parsed.probability < 0 || parsed.probability > 1) return false;
+  parsed.magnitude = defaultMagnitude[kind];
+  if (*end == ',') {
+    const char *from = end + 1;
+    parsed.magnitude = strtod(from, &end);
+    if (end == from) return false;
+  }
+  if (*end == '@') {
+    double start, stop;
+    int used;
+    if (sscanf(end + 1, "%lf-%lf%n", &start, &stop, &used) != 2 || stop <= start) return false;
+    parsed.startMs = (uint32_t)(start * 1000);
+    parsed.endMs = (uint32_t)(stop * 1000);
+    end += 1 + used;
+  }
+  if (*end == '/') {
+    double period, burst;
+    int used;
+    if (sscanf(end + 1, "%lf:%lf%n", &period, &burst, &used) != 2 || period <= 0 || burst > period) return false;
+    parsed.periodMs = (uint32_t)(period * 1000);
+    parsed.burstMs = (uint32_t)(burst * 1000);
+    end += 1 + used;
+  }
+  if (*end) return false;
+  spec[kind] = parsed;
+  return true;
+}
+
+bool FaultPlan::any() const {
+  for (const FaultSpec &s : spec) {
+    if (s.probability > 0) return true;
+  }
+  return false;
+}
@@ -0,0 +1,65 @@
+/**
+ * Fault injection for the host simulator.
+ *
+ * A FaultPlan says, per kind of fault, how likely it is at each opportunity and
+ * when it may happen at all. One plan is shared by every lot in a run; each lot
+ * draws from its own FaultInjector stream, so adding lots or faults to one lot
+ * never changes what happens in another.
+ *
+ * Command-line form, one argument per fault (times in seconds of simulated time):
+ *
+ *   kind=probability[,magnitude][@start-end][/period:burst]
+ *
+ *   echo=0.3                       30 % of ultrasonic echoes are lost
+ *   fsr-noise=0.05,200@600-1800    ±200 count disturbances from minute 10 to 30
+ *   wifi-drop=0.002,45/3600:300    45 s outages, only in the first 5 min of every hour
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include "rng.h"
+
+enum FaultKind : uint8_t {
+  FAULT_ECHO,               // Per ultrasonic reading: no echo, pulseIn runs into its timeout
+  FAULT_FSR_NOISE,          // Per FSR sample: disturbed by up to ±magnitude counts (150)
+  FAULT_RFID,               // Per card read: fails; the driver holds the card up again later
+  FAULT_I2C_NACK,           // Per OLED transfer: not acknowledged, the frame is retried
+  FAULT_WIFI_DROP,          // Per simulated second: access point gone for magnitude s (30)
+  FAULT_CLOUD_LATENCY,      // Per Blynk.run(): takes magnitude ms (800)
+  FAULT_KINDS
+};
+
+struct FaultSpec {
+  double probability = 0;
+  double magnitude = 0;
+  uint32_t startMs = 0;
+  uint32_t endMs = UINT32_MAX;
+  uint32_t periodMs = 0;    // 0 = active for the whole window
+  uint32_t burstMs = 0;     // Active at the start of every period for this long
+
+  bool activeAt(uint32_t nowMs) const;
+};
+
+struct FaultPlan {
+  FaultSpec spec[FAULT_KINDS];
+
+  // Adds one fault in command-line form; false if it does not parse
+  bool parse(const char *arg);
+  bool any() const;
+};
+
+const char *faultName(uint8_t kind);
+
+// Per-lot fault stream and counters. Plain data.
+struct FaultInjector {
+  Rng rng;
+  uint32_t injected[FAULT_KINDS];
+
+  bool fire(const FaultPlan &plan, FaultKind kind, uint32_t nowMs) {
+    const FaultSpec &spec = plan.spec[kind];
+    if (spec.probability <= 0 || !spec.activeAt(nowMs) || !rng.chance(spec.probability)) return false;
+    injected[kind]++;
+    return true;
+  }
+};
@@ -0,0 +1,158 @@
+/**
+ * firmware_bench – runs the firmware itself, main.c++ unchanged, in a simulated
+ * lot and reports what each loop() pass costs.
+ *
+ *   firmware_bench [-t hours] [-s seed] [--rate cars/h] [--stay minutes]
+ *                  [--cycles-per-block n] [fault ...] [@scenario-file ...]
+ *
+ * Options, faults and scenario files are fleet's (see args.h), so the files in
+ * bench/ drive both. The sketch is built for the host against the Arduino
+ * stand-ins in board/, which turn every hardware access into a Hal call on the
+ * same world, with the same faults, as the reference controller (board.h).
+ * setup() runs once, then loop() once per scheduler pass.
+ *
+ * Per loop() pass the report gives the basic blocks executed (exact, from the
+ * coverage instrumentation), the host instructions spent in firmware code (when
+ * the kernel grants a perf counter) and approximate Cortex-M4 cycles: blocks
+ * times --cycles-per-block plus the time spent waiting on hardware at 48 MHz.
+ *
+ * The same lot also runs with the reference controller from controller.h, with
+ * the same traffic, and the report puts the two side by side; a difference there
+ * is a difference between the firmware and its port.
+ *
+ * The sketch keeps its state in globals, so a process runs one lot. main.c++
+ * has three spots.
+ *
+ * Build: make firmware_bench (see Makefile); make bench replays every scenario in bench/.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "args.h"
+#include "board.h"
+#include "lot.h"
+
+#define FIRMWARE_SPOTS  3                   // totalSpots in main.c++
+
+// The sketch (firmware_main.cpp)
+void setup();
+void loop();
+extern uint8_t occupancyBits[];
+extern int availableSpots;
+extern int shownAvailable;
+
+struct LoopCost {
+  Histogram blocks;
+  Histogram instructions;
+  Histogram cycles;
+};
+
+// Lot::advance() driver that runs the sketch
+class Firmware {
+ public:
+  uint64_t pass(Hal &hal) {
+    boardAttach(hal, FIRMWARE_SPOTS);
+    if (!started_) {
+      setup();
+      started_ = true;
+    }
+    uint64_t blocks = boardBlocks(), instructions = boardInstructions(), waitUs = boardWaitUs();
+    loop();
+    uint64_t endUs = boardNowUs();
+    blocks = boardBlocks() - blocks;
+    cost.blocks.add((uint32_t)blocks);
+    if (boardCountsInstructions()) cost.instructions.add((uint32_t)(boardInstructions() - instructions));
+    uint64_t cycles = blocks * boardCyclesPerBlock + (boardWaitUs() - waitUs) * BOARD_CPU_HZ / 1000000ULL;
+    cost.cycles.add(cycles > UINT32_MAX ? UINT32_MAX : (uint32_t)cycles);
+    boardDetach();
+    return endUs + SIM_PASS_US;
+  }
+
+  uint16_t occupiedBits() const {
+    uint16_t bits = 0;
+    for (int i = 0; i < (FIRMWARE_SPOTS + 7) / 8; i++) bits |= occupancyBits[i] << (8 * i);
+    return bits;
+  }
+
+  // The panel shows nothing before the first frame; drivers then go by the count
+  uint8_t shownAvailable() const { return ::shownAvailable < 0 ? availableSpots : ::shownAvailable; }
+
+  LoopCost cost = LoopCost();
+
+ private:
+  bool started_ = false;
+};
+
+static void usage(const char *argv0) {
+  fprintf(stderr, "usage: %s [-t hours] [-s seed] [--rate cars/h] [--stay minutes] [--cycles-per-block n]\n"
+                  "       [fault ...] [@scenario-file ...]\n", argv0);
+}
+
+static void printCost(const char *label, const Histogram &h) {
+  printf("  %-30s %12.1f %12u %12u\n", label, h.mean(), h.percentile(0.99), h.max);
+}
+
+int main(int argc, char **argv) {
+  double hours = 1;
+  uint64_t seed = 1;
+  LotConfig config;
+  config.spots = FIRMWARE_SPOTS;
+  FaultPlan plan;
+
+  Args args;
+  std::string missing;
+  if (!args.load(argc, argv, missing)) {
+    perror(missing.c_str());
+    return 2;
+  }
+  for (size_t i = 1; i < args.size(); i++) {
+    const char *arg = args[i];
+    bool hasValue = i + 1 < args.size();
+    if (!strcmp(arg, "-t") && hasValue) hours = strtod(args[++i], nullptr);
+    else if (!strcmp(arg, "-s") && hasValue) seed = strtoull(args[++i], nullptr, 10);
+    else if (!strcmp(arg, "--rate") && hasValue) config.arrivalsPerHour = strtod(args[++i], nullptr);
+    else if (!strcmp(arg, "--stay") && hasValue) config.meanStayMin = strtod(args[++i], nullptr);
+    else if (!strcmp(arg, "--cycles-per-block") && hasValue) boardCyclesPerBlock = strtoul(args[++i], nullptr, 10);
+    else if (!plan.parse(arg)) {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (hours <= 0 || hours > 1000 || config.arrivalsPerHour <= 0 || !boardCyclesPerBlock) {
+    usage(argv[0]);
+    return 2;
+  }
+  uint32_t untilMs = (uint32_t)(hours * 3600000);
+
+  Lot *lots = new Lot[2];                   // Firmware, reference
+  Firmware firmware;
+  lots[0].init(config, seed, 0);
+  boardSeed(Rng::seeded(seed, 0, STREAM_CONTROLLER));
+  lots[0].advance(untilMs, plan, firmware);
+  lots[1].init(config, seed, 0);
+  lots[1].advance(untilMs, plan);
+
+  printf("firmware build, %.1f h, %u spots, %.1f cars/h, seed %llu, %u cycles/block\n", hours, config.spots,
+         config.arrivalsPerHour, (unsigned long long)seed, boardCyclesPerBlock);
+  printf("  %-30s %12s %12s %12s\n", "loop() per pass", "mean", "p99", "max");
+  printCost("basic blocks", firmware.cost.blocks);
+  if (boardCountsInstructions()) printCost("host instructions", firmware.cost.instructions);
+  else printf("  %-30s %12s\n", "host instructions", "n/a");
+  printCost("cycles (approx.)", firmware.cost.cycles);
+  printf("  %-30s %12llu\n", "passes", (unsigned long long)firmware.cost.blocks.count);
+
+  printf("\n  %-30s %12s %12s\n", "", "firmware", "reference");
+  const LotStats &f = lots[0].stats, &r = lots[1].stats;
+  printf("  %-30s %12.2f %12.2f\n", "admitted / lot-hour", f.admitted / hours, r.admitted / hours);
+  printf("  %-30s %12u %12u\n", "turned away by the OLED count", f.turnedAway, r.turnedAway);
+  printf("  %-30s %12u %12u\n", "gave up at the gate", f.gaveUp, r.gaveUp);
+  printf("  %-30s %12u %12u\n", "gate closed on a car", f.gateStrikes, r.gateStrikes);
+  printf("  %-30s %12u %12u\n", "gate wait p50 (ms)", f.gateWaitMs.percentile(0.5), r.gateWaitMs.percentile(0.5));
+  printf("  %-30s %12u %12u\n", "occupancy detection p50 (ms)", f.detectionMs.percentile(0.5),
+         r.detectionMs.percentile(0.5));
+  printf("  %-30s %12u %12u\n", "occupancy detection p99 (ms)", f.detectionMs.percentile(0.99),
+         r.detectionMs.percentile(0.99));
+  delete[] lots;
+  return 0;
+}
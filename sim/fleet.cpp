@@ -0,0 +1,127 @@
+/**
+ * fleet – runs many simulated lots and compares them with and without faults.
+ *
+ *   fleet [-n lots] [-t hours] [-s seed] [-j threads] [--spots n] [--rate cars/h]
+ *         [--stay minutes] [--legacy-echo] [--batch] [fault ...] [@scenario-file ...]
+ *
+ * Faults use the form in faults.h, e.g. echo=0.3 or wifi-drop=0.002,45. Every lot
+ * runs twice from the same seed: once fault-free, once with the faults, so the
+ * traffic is identical and every difference in the report comes from the faults.
+ * --legacy-echo runs the controller as it was before pulseIn got a timeout.
+ * Options and faults can also come from scenario files (see args.h), which
+ * firmware_bench replays against the firmware build.
+ *
+ * Lots are independent and spread over threads; results do not depend on -j.
+ * --batch runs them FLEET_BATCH_LANES at a time with their FSR scans through one
+ * ControllerBatch (batch.h); the report is the same as without it.
+ *
+ * Build: make fleet (see Makefile)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "args.h"
+#include "batch.h"
+#include "lot.h"
+#include "results.h"
+
+#define FLEET_BATCH_LANES  1024             // Lots per ControllerBatch with --batch
+
+static FleetResult runFleet(const LotConfig &config, const FaultPlan &plan, uint32_t lots, uint32_t untilMs,
+                            uint64_t seed, unsigned threads, bool batched) {
+  std::atomic<uint32_t> nextLot(0);
+  std::vector<FleetResult> partial(threads, FleetResult());
+  std::vector<std::thread> workers;
+  for (unsigned t = 0; t < threads; t++) {
+    workers.emplace_back([&, t] {
+      if (batched) {
+        std::vector<Lot> chunk(FLEET_BATCH_LANES);
+        ControllerBatch batch;
+        for (uint32_t first; (first = nextLot.fetch_add(FLEET_BATCH_LANES)) < lots;) {
+          uint32_t count = lots - first < FLEET_BATCH_LANES ? lots - first : FLEET_BATCH_LANES;
+          for (uint32_t l = 0; l < count; l++) chunk[l].init(config, seed, first + l);
+          batch.init(count, config.spots, config.threshold);
+          batch.advance(chunk.data(), untilMs, plan);
+          for (uint32_t l = 0; l < count; l++) partial[t].add(chunk[l]);
+        }
+        return;
+      }
+      Lot *lot = new Lot;                   // Too big to keep on a thread stack comfortably
+      for (uint32_t i; (i = nextLot++) < lots;) {
+        lot->init(config, seed, i);
+        lot->advance(untilMs, plan);
+        partial[t].add(*lot);
+      }
+      delete lot;
+    });
+  }
+  FleetResult total = FleetResult();
+  for (unsigned t = 0; t < threads; t++) {
+    workers[t].join();
+    total.merge(partial[t]);
+  }
+  return total;
+}
+
+static void usage(const char *argv0) {
+  fprintf(stderr, "usage: %s [-n lots] [-t hours] [-s seed] [-j threads] [--spots n] [--rate cars/h]\n"
+                  "       [--stay minutes] [--legacy-echo] [--batch] [fault ...] [@scenario-file ...]\n"
+                  "faults: kind=probability[,magnitude][@start-end][/period:burst] (seconds), kinds:", argv0);
+  for (int k = 0; k < FAULT_KINDS; k++) fprintf(stderr, " %s", faultName(k));
+  fprintf(stderr, "\n");
+}
+
+int main(int argc, char **argv) {
+  uint32_t lots = 20;
+  double hours = 4;
+  uint64_t seed = 1;
+  unsigned threads = std::thread::hardware_concurrency();
+  bool batched = false;
+  LotConfig config;
+  FaultPlan plan;
+
+  Args args;
+  std::string missing;
+  if (!args.load(argc, argv, missing)) {
+    perror(missing.c_str());
+    return 2;
+  }
+  for (size_t i = 1; i < args.size(); i++) {
+    const char *arg = args[i];
+    bool hasValue = i + 1 < args.size();
+    if (!strcmp(arg, "-n") && hasValue) lots = strtoul(args[++i], nullptr, 10);
+    else if (!strcmp(arg, "-t") && hasValue) hours = strtod(args[++i], nullptr);
+    else if (!strcmp(arg, "-s") && hasValue) seed = strtoull(args[++i], nullptr, 10);
+    else if (!strcmp(arg, "-j") && hasValue) threads = strtoul(args[++i], nullptr, 10);
+    else if (!strcmp(arg, "--spots") && hasValue) config.spots = atoi(args[++i]);
+    else if (!strcmp(arg, "--rate") && hasValue) config.arrivalsPerHour = strtod(args[++i], nullptr);
+    else if (!strcmp(arg, "--stay") && hasValue) config.meanStayMin = strtod(args[++i], nullptr);
+    else if (!strcmp(arg, "--legacy-echo")) config.legacyEcho = true;
+    else if (!strcmp(arg, "--batch")) batched = true;
+    else if (!plan.parse(arg)) {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (!lots || hours <= 0 || hours > 1000 || config.spots < 1 || config.spots > SIM_MAX_SPOTS ||
+      config.arrivalsPerHour <= 0) {
+    usage(argv[0]);
+    return 2;
+  }
+  if (!threads) threads = 1;
+
+  uint32_t untilMs = (uint32_t)(hours * 3600000);
+  printf("%u lots x %.1f h, %u spots, %.1f cars/h, seed %llu%s\n", lots, hours, config.spots,
+         config.arrivalsPerHour, (unsigned long long)seed, config.legacyEcho ? ", legacy echo handling" : "");
+  FleetResult base = runFleet(config, FaultPlan(), lots, untilMs, seed, threads, batched);
+  FleetResult faulted = plan.any() ? runFleet(config, plan, lots, untilMs, seed, threads, batched) : FleetResult();
+  const char *const names[] = { "baseline", "faults" };
+  const FleetResult results[] = { base, faulted };
+  printReport(names, results, plan.any() ? 2 : 1, lots * hours);
+  return 0;
+}
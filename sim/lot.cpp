@@ -0,0 +1,459 @@
+/**
+ * Lot world, traffic and hardware model (see lot.h).
+ */
+#include "lot.h"
+
+#define FSR_FREE_LEVEL        40
+#define FSR_OCCUPIED_LEVEL   780
+#define FSR_JITTER             6            // Natural noise, ± counts
+#define ARM_CAR_CM             8            // Echo distance with a car under the arm
+#define ARM_EMPTY_CM         150            // ... and without
+#define ECHO_US_PER_CM        58            // Round trip
+#define PARKING_MS         20000            // Gate arm to the car resting on its FSR
+
+// Hardware call costs, µs
+#define COST_ANALOG_READ      20
+#define COST_CARD_POLL       300
+#define COST_CARD_READ      1500
+#define COST_OLED_FLUSH     1800
+#define COST_OLED_NACK      1000
+#define COST_WIFI_STATUS      50
+#define COST_WIFI_BEGIN     2000            // Credentials over the AT link; the join runs in the modem
+#define COST_CLOUD_SOCKET  60000            // Modem opens the TCP socket to the Blynk server
+#define COST_CLOUD_SOCKET_FAIL 20000
+#define COST_CLOUD_PUBLISH   300
+#define COST_I2C_START        25            // Start + address at 400 kHz
+#define COST_I2C_BYTE         23            // 9 bits at 400 kHz
+
+void LotStats::merge(const LotStats &other) {
+  arrived += other.arrived;
+  admitted += other.admitted;
+  parked += other.parked;
+  turnedAway += other.turnedAway;
+  gaveUp += other.gaveUp;
+  foundFull += other.foundFull;
+  gateStrikes += other.gateStrikes;
+  sentOn += other.sentOn;
+  arrivedFromRoad += other.arrivedFromRoad;
+  leftUnparked += other.leftUnparked;
+  wifiDownMs += other.wifiDownMs;
+  gateWaitMs.merge(other.gateWaitMs);
+  detectionMs.merge(other.detectionMs);
+}
+
+// —— Hardware ——
+
+uint16_t Hal::analogRead(uint8_t spot) {
+  spend(COST_ANALOG_READ);
+  int level = lot_.truth_ & (1 << spot) ? FSR_OCCUPIED_LEVEL : FSR_FREE_LEVEL;
+  level += lot_.sensors_.between(-FSR_JITTER, FSR_JITTER);
+  if (lot_.faults.fire(plan_, FAULT_FSR_NOISE, nowMs())) {
+    int magnitude = (int)plan_.spec[FAULT_FSR_NOISE].magnitude;
+    level += lot_.faults.rng.between(-magnitude, magnitude);
+  }
+  return level < 0 ? 0 : level > 1023 ? 1023 : level;
+}
+
+uint32_t Hal::pulseIn(uint32_t timeoutUs) {
+  spend(12);                                // Trigger pulse
+  if (lot_.faults.fire(plan_, FAULT_ECHO, nowMs())) {
+    spend(timeoutUs);
+    return 0;
+  }
+  bool carUnderArm = false;
+  for (const Car &car : lot_.cars_) carUnderArm |= car.phase == CAR_UNDER_ARM;
+  uint32_t echoUs = (carUnderArm ? ARM_CAR_CM : ARM_EMPTY_CM) * ECHO_US_PER_CM;
+  if (echoUs > timeoutUs) {
+    spend(timeoutUs);
+    return 0;
+  }
+  spend(echoUs);
+  return echoUs;
+}
+
+bool Hal::readCard(uint16_t &tag) {
+  spend(COST_CARD_POLL);
+  int8_t head = lot_.gateHead();
+  if (head < 0) return false;
+  Car &car = lot_.cars_[head];
+  if (car.cardAccepted || nowMs() < car.presentMs) return false;
+
+  spend(COST_CARD_READ);
+  if (lot_.faults.fire(plan_, FAULT_RFID, nowMs())) {
+    car.presentMs = nowMs() + SIM_RFID_RETRY_MS;
+    return false;
+  }
+  if (car.authorized) {
+    tag = SIM_AUTHORIZED_TAG;
+    car.cardAccepted = true;
+    lot_.admitHead(nowMs());                // Gate may already be open
+  } else {
+    tag = 0xBEEF;
+    car.presentMs = nowMs() + SIM_DENIED_RETRY_MS;
+  }
+  return true;
+}
+
+bool Hal::displayFlush() {
+  if (lot_.faults.fire(plan_, FAULT_I2C_NACK, nowMs())) {
+    spend(COST_OLED_NACK);
+    return false;
+  }
+  spend(COST_OLED_FLUSH);
+  return true;
+}
+
+bool Hal::wifiConnected() {
+  spend(COST_WIFI_STATUS);
+  return lot_.wifiJoined_ && nowMs() >= lot_.wifiReadyAtMs_ && nowMs() >= lot_.wifiDownUntilMs_;
+}
+
+void Hal::wifiBegin() {
+  spend(COST_WIFI_BEGIN);
+  // A join started during an outage fails in the modem
+  lot_.wifiJoined_ = nowMs() >= lot_.wifiDownUntilMs_;
+  lot_.wifiReadyAtMs_ = nowMs() + SIM_WIFI_JOIN_MS;
+}
+
+bool Hal::cloudConnected() {
+  return lot_.cloudConnected_ && nowMs() >= lot_.cloudReadyAtMs_ && nowMs() >= lot_.wifiDownUntilMs_;
+}
+
+bool Hal::cloudConnect() {
+  bool up = lot_.wifiJoined_ && nowMs() >= lot_.wifiDownUntilMs_;
+  spend(up ? COST_CLOUD_SOCKET : COST_CLOUD_SOCKET_FAIL);
+  lot_.cloudConnected_ = up;
+  lot_.cloudReadyAtMs_ = nowMs() + SIM_CLOUD_LOGIN_MS;
+  return up;
+}
+
+void Hal::cloudRun() {
+  if (lot_.faults.fire(plan_, FAULT_CLOUD_LATENCY, nowMs())) {
+    spend((uint64_t)(plan_.spec[FAULT_CLOUD_LATENCY].magnitude * 1000));
+  } else {
+    spend(lot_.cloud_.between(100, 400));
+  }
+}
+
+void Hal::cloudPublish() {
+  spend(COST_CLOUD_PUBLISH);
+}
+
+bool Hal::i2cWrite(uint16_t bytes) {
+  if (lot_.faults.fire(plan_, FAULT_I2C_NACK, nowMs())) {
+    spend(COST_I2C_START);                  // Address byte not acknowledged
+    return false;
+  }
+  spend(COST_I2C_START + bytes * COST_I2C_BYTE);
+  return true;
+}
+
+void Hal::setGate(bool open) {
+  spend(20);
+  if (open == lot_.gateOpen_) return;
+  if (!open) {
+    for (const Car &car : lot_.cars_) lot_.stats.gateStrikes += car.phase == CAR_UNDER_ARM;
+  }
+  lot_.gateOpen_ = open;
+  if (open) lot_.admitHead(nowMs());
+}
+
+// —— World ——
+
+void Lot::init(const LotConfig &config, uint64_t seed, uint32_t index) {
+  *this = Lot();
+  config_ = config;
+  traffic_ = Rng::seeded(seed, index, STREAM_TRAFFIC);
+  sensors_ = Rng::seeded(seed, index, STREAM_SENSORS);
+  cloud_ = Rng::seeded(seed, index, STREAM_CLOUD);
+  faults.rng = Rng::seeded(seed, index, STREAM_FAULTS);
+  controller.init(config.spots, config.threshold, config.legacyEcho, Rng::seeded(seed, index, STREAM_CONTROLLER));
+  shown_ = controller.shownAvailable();
+  nextWifiRollMs_ = 1000;
+  schedule((uint32_t)traffic_.exponential(3600000.0 / config.arrivalsPerHour), EV_ARRIVAL, 0);
+}
+
+// Runs the world up to the next pass; false when that is not before untilMs
+bool Lot::runWorld(uint32_t untilMs, const FaultPlan &plan) {
+  uint32_t passMs = (uint32_t)(nextPassUs_ / 1000);
+  uint32_t stepMs = passMs < untilMs ? passMs : untilMs;
+
+  // Outages start on whole simulated seconds
+  for (; nextWifiRollMs_ <= stepMs; nextWifiRollMs_ += 1000) {
+    if (nextWifiRollMs_ < wifiDownUntilMs_) {
+      stats.wifiDownMs += 1000;
+    } else if (faults.fire(plan, FAULT_WIFI_DROP, nextWifiRollMs_)) {
+      wifiDownUntilMs_ = nextWifiRollMs_ + (uint32_t)(plan.spec[FAULT_WIFI_DROP].magnitude * 1000);
+      wifiJoined_ = false;
+      cloudConnected_ = false;
+    }
+  }
+  SimEvent event;
+  while (popDue(stepMs, event)) {
+    nowMs_ = event.atMs;
+    runEvent(event);
+  }
+  nowMs_ = stepMs;
+  return passMs < untilMs;
+}
+
+// What the controller believes and shows after a pass that ended at nowMs
+void Lot::passed(uint32_t nowMs, uint16_t occupied, uint8_t shown) {
+  believed_ = occupied;
+  shown_ = shown;
+  checkDetection(nowMs);
+}
+
+bool Lot::advanceToScan(uint32_t untilMs, const FaultPlan &plan, uint16_t *levels) {
+  while (runWorld(untilMs, plan)) {
+    Hal hal(*this, plan, nextPassUs_);
+    if (controller.beginPass(hal, levels)) {
+      nextPassUs_ = hal.nowUs;
+      return true;
+    }
+    nextPassUs_ = controller.endPass(hal, controller.occupiedBits(), false);
+    passed(hal.nowMs(), controller.occupiedBits(), controller.shownAvailable());
+  }
+  return false;
+}
+
+void Lot::finishScan(const FaultPlan &plan, uint16_t occupied, bool changed) {
+  Hal hal(*this, plan, nextPassUs_);
+  nextPassUs_ = controller.endPass(hal, occupied, changed);
+  passed(hal.nowMs(), controller.occupiedBits(), controller.shownAvailable());
+}
+
+void Lot::resetStats() {
+  stats = LotStats();
+  controller.stats = ControllerStats();
+  for (uint32_t &count : faults.injected) count = 0;
+}
+
+void Lot::schedule(uint32_t atMs, uint8_t type, uint8_t car) {
+  if (eventCount_ == SIM_EVENT_CAPACITY) return;    // Cannot happen with SIM_MAX_CARS cars
+  SimEvent event = { atMs, eventSeq_++, type, car, cars_[car].ticket };
+  uint8_t i = eventCount_++;
+  for (; i > 0; i = (i - 1) / 2) {
+    const SimEvent &parent = events_[(i - 1) / 2];
+    if (parent.atMs < atMs || (parent.atMs == atMs && parent.seq < event.seq)) break;
+    events_[i] = parent;
+  }
+  events_[i] = event;
+}
+
+bool Lot::popDue(uint32_t untilMs, SimEvent &event) {
+  if (!eventCount_ || events_[0].atMs > untilMs) return false;
+  event = events_[0];
+  SimEvent last = events_[--eventCount_];
+  uint8_t i = 0;
+  for (;;) {
+    uint8_t child = 2 * i + 1;
+    if (child >= eventCount_) break;
+    const SimEvent &a = events_[child];
+    if (child + 1 < eventCount_) {
+      const SimEvent &b = events_[child + 1];
+      if (b.atMs < a.atMs || (b.atMs == a.atMs && b.seq < a.seq)) child++;
+    }
+    const SimEvent &c = events_[child];
+    if (last.atMs < c.atMs || (last.atMs == c.atMs && last.seq < c.seq)) break;
+    events_[i] = c;
+    i = child;
+  }
+  events_[i] = last;
+  return true;
+}
+
+void Lot::runEvent(const SimEvent &event) {
+  if (event.type == EV_ARRIVAL) {
+    schedule(nowMs_ + (uint32_t)traffic_.exponential(3600000.0 / config_.arrivalsPerHour), EV_ARRIVAL, 0);
+    arrive(nowMs_);
+    return;
+  }
+  Car &car = cars_[event.car];
+  if (car.ticket != event.ticket) return;   // The car this was for is gone
+
+  switch (event.type) {
+    case EV_GIVE_UP:
+      if (car.phase == CAR_AT_GATE) {
+        stats.gaveUp++;
+        leaveQueue(event.car);
+      }
+      break;
+
+    case EV_REACH_ARM:
+      if (!gateOpen_) {
+        // Closed before the car got there: back to the reader, at the front
+        for (uint8_t i = queueLength_; i > 0; i--) queue_[i] = queue_[i - 1];
+        queue_[0] = event.car;
+        queueLength_++;
+        car.phase = CAR_AT_GATE;
+        car.cardAccepted = false;
+        car.presentMs = nowMs_ + SIM_RFID_RETRY_MS;
+        break;
+      }
+      car.phase = CAR_UNDER_ARM;
+      schedule(nowMs_ + car.armMs, EV_CLEAR_ARM, event.car);
+      break;
+
+    case EV_CLEAR_ARM: {
+      stats.admitted++;
+      uint16_t taken = truth_;
+      for (const Car &other : cars_) {
+        if (other.phase == CAR_PARKING) taken |= 1 << other.spot;
+      }
+      uint8_t spot = 0;
+      while (spot < config_.spots && (taken & (1 << spot))) spot++;
+      if (spot == config_.spots) {
+        stats.foundFull++;
+        car.phase = CAR_NONE;
+        sendOn(car, nowMs_);
+        break;
+      }
+      car.phase = CAR_PARKING;
+      car.spot = spot;
+      schedule(nowMs_ + PARKING_MS, EV_PARKED, event.car);
+      break;
+    }
+
+    case EV_PARKED:
+      stats.parked++;
+      car.phase = CAR_PARKED;
+      setSpot(car.spot, true, nowMs_);
+      schedule(nowMs_ + car.stayMs, EV_DEPART, event.car);
+      break;
+
+    case EV_DEPART:
+      setSpot(car.spot, false, nowMs_);
+      car.phase = CAR_NONE;
+      break;
+
+    case EV_ROAD_ARRIVAL: {
+      stats.arrivedFromRoad++;
+      Car arriving = car;
+      car.phase = CAR_NONE;
+      enter(arriving, nowMs_);
+      break;
+    }
+  }
+}
+
+void Lot::arrive(uint32_t nowMs) {
+  stats.arrived++;
+
+  // Every draw is taken whatever happens next, so the traffic stream does not
+  // depend on how the controller behaves
+  Car car = Car();
+  car.authorized = traffic_.chance(config_.authorizedShare);
+  car.presentDelayMs = traffic_.between(2000, 5000);
+  car.approachMs = traffic_.between(1500, 4000);
+  car.armMs = traffic_.between(1500, 3000);
+  car.stayMs = (uint32_t)traffic_.exponential(config_.meanStayMin * 60000.0);
+  car.route = (uint32_t)(traffic_.next() >> 32);
+  enter(car, nowMs);
+}
+
+void Lot::enter(const Car &arriving, uint32_t nowMs) {
+  uint8_t slot = freeSlot();
+  if (shown_ == 0 || slot == SIM_MAX_CARS) {
+    stats.turnedAway++;
+    sendOn(arriving, nowMs);
+    return;
+  }
+  Car &car = cars_[slot];
+  uint16_t ticket = car.ticket;
+  car = arriving;
+  car.phase = CAR_AT_GATE;
+  car.spot = SIM_NO_SPOT;
+  car.ticket = ticket + 1;
+  car.cardAccepted = false;
+  car.arrivedMs = nowMs;
+  car.presentMs = nowMs + car.presentDelayMs;
+  queue_[queueLength_++] = slot;
+  schedule(nowMs + config_.patienceMs, EV_GIVE_UP, slot);
+}
+
+void Lot::sendOn(const Car &car, uint32_t nowMs) {
+  if (car.hops >= config_.maxHops || outboxCount_ == SIM_OUTBOX_CAPACITY) {
+    stats.leftUnparked++;
+    return;
+  }
+  stats.sentOn++;
+  CarTransfer &transfer = outbox_[outboxCount_++];
+  transfer.leftMs = nowMs;
+  transfer.seq = sentSeq_++;
+  transfer.route = car.route;
+  transfer.stayMs = car.stayMs;
+  transfer.approachMs = car.approachMs;
+  transfer.armMs = car.armMs;
+  transfer.presentDelayMs = car.presentDelayMs;
+  transfer.hops = car.hops + 1;
+  transfer.authorized = car.authorized;
+}
+
+void Lot::receive(const CarTransfer &transfer, uint32_t atMs) {
+  uint8_t slot = freeSlot();
+  if (slot == SIM_MAX_CARS) {
+    stats.leftUnparked++;                   // Nowhere to keep it: counts as lost on the road
+    return;
+  }
+  Car &car = cars_[slot];
+  car.phase = CAR_ON_ROAD;
+  car.ticket++;
+  car.authorized = transfer.authorized;
+  car.approachMs = transfer.approachMs;
+  car.armMs = transfer.armMs;
+  car.presentDelayMs = transfer.presentDelayMs;
+  car.hops = transfer.hops;
+  car.route = transfer.route;
+  car.stayMs = transfer.stayMs;
+  schedule(atMs, EV_ROAD_ARRIVAL, slot);
+}
+
+uint8_t Lot::freeSlot() const {
+  uint8_t slot = 0;
+  while (slot < SIM_MAX_CARS && cars_[slot].phase != CAR_NONE) slot++;
+  return slot;
+}
+
+void Lot::admitHead(uint32_t nowMs) {
+  int8_t head = gateHead();
+  if (head < 0 || !gateOpen_ || !cars_[head].cardAccepted) return;
+  Car &car = cars_[head];
+  stats.gateWaitMs.add(nowMs - car.arrivedMs);
+  leaveQueue(head);
+  car.phase = CAR_APPROACH;
+  schedule(nowMs + car.approachMs, EV_REACH_ARM, head);
+}
+
+void Lot::leaveQueue(uint8_t car) {
+  uint8_t i = 0;
+  while (i < queueLength_ && queue_[i] != car) i++;
+  if (i == queueLength_) return;
+  for (; i + 1 < queueLength_; i++) queue_[i] = queue_[i + 1];
+  queueLength_--;
+  cars_[car].phase = CAR_NONE;
+}
+
+int8_t Lot::gateHead() const {
+  return queueLength_ ? queue_[0] : -1;
+}
+
+void Lot::setSpot(uint8_t spot, bool occupied, uint32_t nowMs) {
+  uint16_t bit = 1 << spot;
+  truth_ = occupied ? truth_ | bit : truth_ & ~bit;
+  if (((truth_ ^ believed_) & bit) == 0) {
+    mismatch_ &= ~bit;                      // Changed back before the controller noticed
+  } else if (!(mismatch_ & bit)) {
+    mismatch_ |= bit;
+    mismatchSinceMs_[spot] = nowMs;
+  }
+}
+
+void Lot::checkDetection(uint32_t nowMs) {
+  uint16_t caughtUp = mismatch_ & ~(truth_ ^ believed_);
+  for (uint8_t spot = 0; caughtUp; spot++, caughtUp >>= 1) {
+    if (!(caughtUp & 1)) continue;
+    stats.detectionMs.add(nowMs - mismatchSinceMs_[spot]);
+    mismatch_ &= ~(1 << spot);
+  }
+}
@@ -0,0 +1,252 @@
+/**
+ * One simulated parking lot: the physical world, its traffic, and the controller
+ * that runs it.
+ *
+ * Cars arrive as a Poisson stream. A driver looks at the OLED count and leaves
+ * when it shows no free spot. Otherwise the driver queues at the reader and holds
+ * up a card, drives through once the gate opens, parks in the first free spot
+ * (pressing its FSR) and leaves after an exponentially distributed stay. A driver
+ * whose card is refused, or who gets no gate within the patience limit, gives up.
+ * A driver who finds the lot full, at the OLED or inside, drives on to another lot
+ * when the lot is part of a road network (LotConfig::maxHops, see road.h).
+ *
+ * The world runs on a queue of timestamped events. The controller runs pass by
+ * pass in between, seeing the world only through a Hal. Everything that can go
+ * wrong in hardware goes wrong inside the Hal, where the FaultPlan applies. The
+ * controller is the reference port in controller.h unless advance() is handed
+ * another one, such as the firmware build in firmware_bench.cpp.
+ *
+ * A Lot holds no pointers: the whole world, RNG streams and event queue included,
+ * is its bytes, so copying a Lot forks it and checkpoint.h saves it as is.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include "controller.h"
+#include "faults.h"
+#include "rng.h"
+#include "stats.h"
+
+#define SIM_MAX_CARS         32
+#define SIM_EVENT_CAPACITY   96
+#define SIM_RFID_RETRY_MS  1500             // Driver holds the card up again after a failed read
+#define SIM_DENIED_RETRY_MS 5000            // ... or after a refused one
+#define SIM_NO_SPOT        0xFF
+#define SIM_OUTBOX_CAPACITY  32             // Cars leaving for other lots between two collections
+#define SIM_WIFI_JOIN_MS    800             // Association after WiFi.begin()
+#define SIM_CLOUD_LOGIN_MS  190             // Blynk login reply after the socket opens
+
+struct LotConfig {
+  uint8_t spots = 3;
+  uint16_t threshold = 400;                 // FSR counts; free spots read ~40, occupied ~780
+  double arrivalsPerHour = 12;
+  double meanStayMin = 30;
+  double authorizedShare = 0.95;
+  uint32_t patienceMs = 60000;
+  bool legacyEcho = false;                  // Controller as before the pulseIn timeout fix
+  uint8_t maxHops = 0;                      // Other lots a driver tries; 0 = lot stands alone
+};
+
+enum CarPhase : uint8_t {
+  CAR_NONE,                                 // Slot unused
+  CAR_AT_GATE,
+  CAR_APPROACH,                             // Gate open, driving up to the arm
+  CAR_UNDER_ARM,
+  CAR_PARKING,
+  CAR_PARKED,
+  CAR_ON_ROAD,                              // Driving here from another lot
+};
+
+struct Car {
+  uint8_t phase;
+  uint8_t spot;
+  uint16_t ticket;                          // Bumped on every reuse of the slot
+  bool authorized;
+  bool cardAccepted;                        // Read and accepted, waiting for an open gate
+  uint16_t approachMs;                      // Gate open → front wheels under the arm
+  uint16_t armMs;                           // Time spent under the arm
+  uint16_t presentDelayMs;                  // Arrival → card held up
+  uint8_t hops;                             // Lots tried before this one
+  uint32_t route;                           // Random bits choosing each next lot
+  uint32_t stayMs;
+  uint32_t arrivedMs;
+  uint32_t presentMs;                       // Card held against the reader from then on
+};
+
+// A car that left for another lot, as it travels between logical processes
+struct CarTransfer {
+  uint32_t leftMs;
+  uint32_t seq;                             // Per origin lot, orders transfers that leave together
+  uint32_t route;
+  uint32_t stayMs;
+  uint16_t approachMs;
+  uint16_t armMs;
+  uint16_t presentDelayMs;
+  uint8_t hops;                             // Lots tried so far, this one included
+  bool authorized;
+};
+
+enum SimEventType : uint8_t {
+  EV_ARRIVAL,
+  EV_REACH_ARM,
+  EV_CLEAR_ARM,
+  EV_PARKED,
+  EV_DEPART,
+  EV_GIVE_UP,
+  EV_ROAD_ARRIVAL,
+};
+
+struct SimEvent {
+  uint32_t atMs;
+  uint32_t seq;                             // Events at the same time run in scheduling order
+  uint8_t type;
+  uint8_t car;
+  uint16_t ticket;                          // Stale once the car slot was reused
+};
+
+struct LotStats {
+  uint32_t arrived;
+  uint32_t admitted;                        // Drove through the gate
+  uint32_t parked;
+  uint32_t turnedAway;                      // OLED showed no free spot
+  uint32_t gaveUp;                          // Waited at the gate past their patience
+  uint32_t foundFull;                       // Drove in, but every spot was taken
+  uint32_t gateStrikes;                     // Gate closed on a car under the arm
+  uint32_t sentOn;                          // Found it full and drove to another lot
+  uint32_t arrivedFromRoad;                 // Came from another lot
+  uint32_t leftUnparked;                    // Found it full with no lot left to try
+  uint32_t wifiDownMs;
+  Histogram gateWaitMs;                     // Arrival at the reader → gate open for the car
+  Histogram detectionMs;                    // Car parked or left → controller agrees
+
+  void merge(const LotStats &other);
+};
+
+class Lot;
+
+/**
+ * The controller's view of the hardware for one pass. Every call advances nowUs
+ * by the time the real call takes.
+ */
+class Hal {
+ public:
+  Hal(Lot &lot, const FaultPlan &plan, uint64_t nowUs) : nowUs(nowUs), lot_(lot), plan_(plan) {}
+
+  uint32_t nowMs() const { return (uint32_t)(nowUs / 1000); }
+
+  uint16_t analogRead(uint8_t spot);
+  uint32_t pulseIn(uint32_t timeoutUs);     // Echo length, or 0 after timeoutUs
+  bool readCard(uint16_t &tag);             // A newly presented card, as the MFRC522 reports it
+  bool displayFlush();                      // False on a NACK
+  bool wifiConnected();                     // Associated, as WiFi.status() reports
+  void wifiBegin();                         // Starts a join; it completes SIM_WIFI_JOIN_MS later
+  bool cloudConnected();                    // Logged in to Blynk
+  bool cloudConnect();                      // Opens the socket; the login completes SIM_CLOUD_LOGIN_MS later
+  void cloudRun();
+  void cloudPublish();
+  void setGate(bool open);
+  bool i2cWrite(uint16_t bytes);            // One Wire transaction; false on a NACK
+
+  uint64_t nowUs;
+
+ private:
+  void spend(uint64_t us) { nowUs += us; }
+
+  Lot &lot_;
+  const FaultPlan &plan_;
+};
+
+class Lot {
+ public:
+  void init(const LotConfig &config, uint64_t seed, uint32_t index);
+
+  // Runs world and controller up to untilMs of simulated time
+  void advance(uint32_t untilMs, const FaultPlan &plan) { advance(untilMs, plan, controller); }
+
+  // The same with another controller in the loop. Driver needs Controller's
+  // pass(), occupiedBits() and shownAvailable().
+  template <class Driver>
+  void advance(uint32_t untilMs, const FaultPlan &plan, Driver &driver);
+
+  // advance() with the controller's FSR path in a ControllerBatch: runs up to
+  // the first pass that scans the FSRs and stops inside it, with the samples in
+  // levels, or returns false once untilMs is reached. finishScan() hands back the
+  // occupancy the batch computed and completes that pass.
+  bool advanceToScan(uint32_t untilMs, const FaultPlan &plan, uint16_t *levels);
+  void finishScan(const FaultPlan &plan, uint16_t occupied, bool changed);
+
+  // Clears lot, controller and fault counters, e.g. after a warm-up
+  void resetStats();
+  uint32_t nowMs() const { return nowMs_; }
+
+  // Cars that left for other lots since the last clearOutbox(), oldest first
+  const CarTransfer *outbox() const { return outbox_; }
+  uint8_t outboxCount() const { return outboxCount_; }
+  void clearOutbox() { outboxCount_ = 0; }
+
+  // A car from another lot reaching this one at atMs, which must be after nowMs()
+  void receive(const CarTransfer &transfer, uint32_t atMs);
+
+  LotStats stats;
+  Controller controller;
+  FaultInjector faults;
+
+ private:
+  friend class Hal;
+
+  bool runWorld(uint32_t untilMs, const FaultPlan &plan);
+  void passed(uint32_t nowMs, uint16_t occupied, uint8_t shown);
+  void schedule(uint32_t atMs, uint8_t type, uint8_t car);
+  bool popDue(uint32_t untilMs, SimEvent &event);
+  void runEvent(const SimEvent &event);
+  void arrive(uint32_t nowMs);
+  void enter(const Car &arriving, uint32_t nowMs);
+  void sendOn(const Car &car, uint32_t nowMs);
+  uint8_t freeSlot() const;
+  void admitHead(uint32_t nowMs);
+  void leaveQueue(uint8_t car);
+  void setSpot(uint8_t spot, bool occupied, uint32_t nowMs);
+  void checkDetection(uint32_t nowMs);
+  int8_t gateHead() const;
+
+  LotConfig config_;
+  Rng traffic_;
+  Rng sensors_;
+  Rng cloud_;                               // Blynk.run() latency
+  uint32_t nowMs_;
+  uint64_t nextPassUs_;                     // While a pass waits on the batch: its clock
+  uint32_t nextWifiRollMs_;
+
+  Car cars_[SIM_MAX_CARS];
+  uint8_t queue_[SIM_MAX_CARS];             // Cars at the gate, oldest first
+  uint8_t queueLength_;
+  SimEvent events_[SIM_EVENT_CAPACITY];     // Binary min-heap on (atMs, seq)
+  uint8_t eventCount_;
+  uint32_t eventSeq_;
+
+  uint16_t believed_;                       // Controller's occupancy after its last pass
+  uint8_t shown_;                           // ... and the count on its OLED
+  uint16_t truth_;                          // Spots with a car on them
+  uint32_t mismatchSinceMs_[SIM_MAX_SPOTS]; // Truth changed, controller not yet caught up
+  uint16_t mismatch_;
+  bool gateOpen_;
+  bool wifiJoined_;
+  uint32_t wifiReadyAtMs_;
+  bool cloudConnected_;
+  uint32_t cloudReadyAtMs_;
+  uint32_t wifiDownUntilMs_;
+
+  CarTransfer outbox_[SIM_OUTBOX_CAPACITY];
+  uint8_t outboxCount_;
+  uint32_t sentSeq_;
+};
+
+template <class Driver>
+void Lot::advance(uint32_t untilMs, const FaultPlan &plan, Driver &driver) {
+  while (runWorld(untilMs, plan)) {
+    Hal hal(*this, plan, nextPassUs_);
+    nextPassUs_ = driver.pass(hal);
+    passed(hal.nowMs(), driver.occupiedBits(), driver.shownAvailable());
+  }
+}
@@ -0,0 +1,112 @@
+/**
+ * Fleet totals and report (see results.h).
+ */
+#include "results.h"
+
+#include <stdio.h>
+
+void FleetResult::add(const Lot &lot) {
+  lots.merge(lot.stats);
+  controllers.merge(lot.controller.stats);
+  for (int k = 0; k < FAULT_KINDS; k++) injected[k] += lot.faults.injected[k];
+}
+
+void FleetResult::merge(const FleetResult &other) {
+  lots.merge(other.lots);
+  controllers.merge(other.controllers);
+  for (int k = 0; k < FAULT_KINDS; k++) injected[k] += other.injected[k];
+}
+
+static const char *const labels[] = {
+  "arrivals / lot-hour",
+  "admitted / lot-hour",
+  "turned away by the OLED count",
+  "gave up at the gate",
+  "drove in, found no spot",
+  "gate closed on a car",
+  "sent on to another lot",
+  "arrived from another lot",
+  "left without parking",
+  "gate wait p50 (ms)",
+  "gate wait p99 (ms)",
+  "occupancy detection p50 (ms)",
+  "occupancy detection p99 (ms)",
+  "cloud staleness p50 (ms)",
+  "cloud staleness p99 (ms)",
+  "scheduler pass p99.99 (ms)",
+  "scheduler pass max (ms)",
+  "controller busy (%)",
+  "echo timeouts",
+  "missing echoes taken for a car",
+  "display NACKs",
+  "slow Blynk.run() calls",
+  "link drops",
+  "WiFi down (s / lot-hour)",
+};
+#define REPORT_ROWS (sizeof(labels) / sizeof(labels[0]))
+
+// Values in the order of labels
+static void metrics(const FleetResult &r, double lotHours, double *out) {
+  const LotStats &l = r.lots;
+  const ControllerStats &c = r.controllers;
+  double values[] = {
+    l.arrived / lotHours,
+    l.admitted / lotHours,
+    (double)l.turnedAway,
+    (double)l.gaveUp,
+    (double)l.foundFull,
+    (double)l.gateStrikes,
+    (double)l.sentOn,
+    (double)l.arrivedFromRoad,
+    (double)l.leftUnparked,
+    (double)l.gateWaitMs.percentile(0.5),
+    (double)l.gateWaitMs.percentile(0.99),
+    (double)l.detectionMs.percentile(0.5),
+    (double)l.detectionMs.percentile(0.99),
+    (double)c.cloudStalenessMs.percentile(0.5),
+    (double)c.cloudStalenessMs.percentile(0.99),
+    (double)c.passMs.percentile(0.9999),
+    (double)c.passMs.max,
+    c.busyUs / (lotHours * 36000000.0),
+    (double)c.echoTimeouts,
+    (double)c.phantomPassages,
+    (double)c.displayNacks,
+    (double)c.slowCloudRuns,
+    (double)c.linkDrops,
+    l.wifiDownMs / 1000.0 / lotHours,
+  };
+  static_assert(sizeof(values) / sizeof(values[0]) == REPORT_ROWS, "one value per label");
+  for (size_t i = 0; i < REPORT_ROWS; i++) out[i] = values[i];
+}
+
+void printReport(const char *const *names, const FleetResult *results, int columns, double lotHours) {
+  printf("  %-34s", "");
+  for (int c = 0; c < columns; c++) printf(c ? " %21.21s" : " %12.12s", names[c]);
+  printf("\n");
+
+  double base[REPORT_ROWS], value[REPORT_ROWS];
+  metrics(results[0], lotHours, base);
+  for (size_t i = 0; i < REPORT_ROWS; i++) {
+    printf("  %-34s %12.2f", labels[i], base[i]);
+    for (int c = 1; c < columns; c++) {
+      metrics(results[c], lotHours, value);
+      if (base[i] != 0) {
+        printf(" %12.2f %+7.1f%%", value[i], 100.0 * (value[i] - base[i]) / base[i]);
+      } else {
+        printf(" %12.2f%*s", value[i], c + 1 < columns ? 9 : 0, "");
+      }
+    }
+    printf("\n");
+  }
+
+  for (int c = 0; c < columns; c++) {
+    bool any = false;
+    for (int k = 0; k < FAULT_KINDS; k++) any |= results[c].injected[k] != 0;
+    if (!any) continue;
+    printf("\n  injected faults, %s:", names[c]);
+    for (int k = 0; k < FAULT_KINDS; k++) {
+      if (results[c].injected[k]) printf("  %s=%llu", faultName(k), (unsigned long long)results[c].injected[k]);
+    }
+    printf("\n");
+  }
+}
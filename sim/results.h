@@ -0,0 +1,21 @@
+/**
+ * Fleet-wide totals and the side-by-side report printed by the simulator tools.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include "lot.h"
+
+struct FleetResult {
+  LotStats lots;
+  ControllerStats controllers;
+  uint64_t injected[FAULT_KINDS];
+
+  void add(const Lot &lot);
+  void merge(const FleetResult &other);
+};
+
+// One column per result; every column after the first also shows its change
+// against the first
+void printReport(const char *const *names, const FleetResult *results, int columns, double lotHours);
@@ -0,0 +1,49 @@
+/**
+ * Deterministic random streams for the simulator.
+ *
+ * xorshift64* seeded through SplitMix64. Every consumer (traffic, sensor noise,
+ * faults, link jitter) owns its own stream derived from the run seed, the lot
+ * index and a stream id, so changing how often one consumer draws never shifts
+ * what another one sees. The state is a single word and can be copied freely.
+ */
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+
+enum RngStream : uint64_t {
+  STREAM_TRAFFIC    = 1,
+  STREAM_SENSORS    = 2,
+  STREAM_FAULTS     = 3,
+  STREAM_CONTROLLER = 4,
+  STREAM_CLOUD      = 5,
+};
+
+struct Rng {
+  uint64_t state;
+
+  static Rng seeded(uint64_t seed, uint64_t lot, uint64_t stream) {
+    uint64_t z = seed ^ (lot * 0x9E3779B97F4A7C15ULL) ^ (stream << 56);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    return Rng{ z ? z : 1 };
+  }
+
+  uint64_t next() {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545F4914F6CDD1DULL;
+  }
+
+  // Uniform in [0, 1)
+  double uniform() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+
+  bool chance(double p) { return p > 0 && uniform() < p; }
+
+  // Uniform integer in [lo, hi]
+  int32_t between(int32_t lo, int32_t hi) { return lo + (int32_t)(uniform() * (hi - lo + 1)); }
+
+  double exponential(double mean) { return -mean * log(1.0 - uniform()); }
+};
@@ -0,0 +1,44 @@
+/**
+ * Road network between simulated lots.
+ *
+ * Lots sit on a wrapped grid, ROW_LOTS wide at most: lot i reaches i ± 1 along
+ * its street and i ± width across. A driver who finds a lot full takes one of the
+ * four roads, picked by two bits of the car's route per hop, so where a car goes
+ * is fixed at its first arrival and never depends on thread timing.
+ *
+ * Every road takes at least ROAD_MIN_DRIVE_MS. That minimum is the lookahead of
+ * the parallel simulation: nothing a lot does before t can reach another lot
+ * before t + ROAD_MIN_DRIVE_MS.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#define ROAD_MIN_DRIVE_MS    60000
+#define ROAD_DRIVE_SPREAD_MS 120000         // Longest road: minimum + spread
+#define ROAD_ROW_LOTS        64
+
+struct RoadNetwork {
+  uint32_t lots;
+  uint32_t width;
+
+  explicit RoadNetwork(uint32_t lotCount) : lots(lotCount) {
+    width = 1;
+    while (width < ROAD_ROW_LOTS && width * width < lotCount) width++;
+  }
+
+  // Lot the car drives to on leaving lot from for the hops-th time (1-based)
+  uint32_t next(uint32_t from, uint32_t route, uint8_t hops) const {
+    uint32_t step = (route >> (2 * ((hops - 1) & 15))) & 3;
+    uint32_t offset = step < 2 ? 1 : width % lots;
+    return step & 1 ? (from + offset) % lots : (from + lots - offset) % lots;
+  }
+
+  // Same both ways and fixed per road
+  uint32_t driveMs(uint32_t a, uint32_t b) const {
+    uint64_t key = a < b ? (uint64_t)a << 32 | b : (uint64_t)b << 32 | a;
+    key = (key ^ (key >> 33)) * 0xFF51AFD7ED558CCDULL;
+    key ^= key >> 33;
+    return ROAD_MIN_DRIVE_MS + (uint32_t)(key % (ROAD_DRIVE_SPREAD_MS + 1));
+  }
+};
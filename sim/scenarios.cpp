@@ -0,0 +1,223 @@
+/**
+ * scenarios – what-if runs forked from one warmed-up world.
+ *
+ *   scenarios [-n lots] [-s seed] [-j threads] [--spots n] [--rate cars/h] [--stay minutes]
+ *             (--warmup hours | --load file) [--save file] -t hours variant ...
+ *
+ * The lots first run fault-free through the warm-up, or are read back from a
+ * checkpoint (the lot options are then ignored). Every variant continues from
+ * that same state for -t hours: the same cars at the same moments, only the
+ * variant's changes differ. A variant is a '+'-separated list of gate timings
+ * (settle=ms, poll=ms, close=ms) and faults in fleet's form, e.g.
+ *
+ *   scenarios -n 50 --warmup 6 --save rush.ckpt -t 2 close=4000 close=1500+echo=0.3
+ *   scenarios --load rush.ckpt -t 2 settle=1000+poll=50
+ *
+ * Fault windows (@start-end) count from the start of the warm-up.
+ *
+ * Each variant runs in a fork()ed child, which sees the warmed-up lots through
+ * copy-on-write pages instead of repeating the warm-up or copying the world up
+ * front, and sends its totals back through a pipe. Children run side by side.
+ * The first report column is the unchanged continuation.
+ *
+ * Build: g++ -std=c++17 -O2 -pthread -I.. -o scenarios scenarios.cpp checkpoint.cpp results.cpp lot.cpp controller.cpp faults.cpp
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "checkpoint.h"
+#include "lot.h"
+#include "results.h"
+
+struct Variant {
+  std::string name;
+  uint32_t settleMs = 0;                    // 0 = as warmed up
+  uint32_t pollMs = 0;
+  uint32_t closeDelayMs = 0;
+  FaultPlan plan;
+};
+
+static bool parseVariant(const char *arg, Variant &variant) {
+  variant.name = arg;
+  std::string rest = arg;
+  while (!rest.empty()) {
+    size_t plus = rest.find('+');
+    std::string part = rest.substr(0, plus);
+    rest = plus == std::string::npos ? "" : rest.substr(plus + 1);
+
+    uint32_t *timing = nullptr;
+    if (!part.compare(0, 7, "settle=")) timing = &variant.settleMs;
+    else if (!part.compare(0, 5, "poll=")) timing = &variant.pollMs;
+    else if (!part.compare(0, 6, "close=")) timing = &variant.closeDelayMs;
+    if (!timing) {
+      if (!variant.plan.parse(part.c_str())) return false;
+      continue;
+    }
+    char *end;
+    const char *value = part.c_str() + part.find('=') + 1;
+    *timing = strtoul(value, &end, 10);
+    if (end == value || *end || !*timing) return false;
+  }
+  return true;
+}
+
+static void advanceAll(std::vector<Lot> &lots, uint32_t untilMs, const FaultPlan &plan, unsigned threads) {
+  std::atomic<size_t> next(0);
+  std::vector<std::thread> workers;
+  for (unsigned t = 0; t < threads; t++) {
+    workers.emplace_back([&] {
+      for (size_t i; (i = next++) < lots.size();) lots[i].advance(untilMs, plan);
+    });
+  }
+  for (std::thread &worker : workers) worker.join();
+}
+
+// In the child: apply the variant to its copy-on-write lots and run them
+static FleetResult runVariant(std::vector<Lot> &lots, const Variant &variant, uint32_t untilMs, unsigned threads) {
+  for (Lot &lot : lots) {
+    GateTiming &timing = lot.controller.gateTiming;
+    if (variant.settleMs) timing.settleMs = variant.settleMs;
+    if (variant.pollMs) timing.pollMs = variant.pollMs;
+    if (variant.closeDelayMs) timing.closeDelayMs = variant.closeDelayMs;
+  }
+  advanceAll(lots, untilMs, variant.plan, threads);
+  FleetResult result = FleetResult();
+  for (const Lot &lot : lots) result.add(lot);
+  return result;
+}
+
+static bool readAll(int fd, void *buf, size_t size) {
+  uint8_t *p = (uint8_t *)buf;
+  while (size) {
+    ssize_t n = read(fd, p, size);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    p += n;
+    size -= n;
+  }
+  return true;
+}
+
+static bool writeAll(int fd, const void *buf, size_t size) {
+  const uint8_t *p = (const uint8_t *)buf;
+  while (size) {
+    ssize_t n = write(fd, p, size);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    p += n;
+    size -= n;
+  }
+  return true;
+}
+
+static void usage(const char *argv0) {
+  fprintf(stderr, "usage: %s [-n lots] [-s seed] [-j threads] [--spots n] [--rate cars/h] [--stay minutes]\n"
+                  "       (--warmup hours | --load file) [--save file] -t hours variant ...\n"
+                  "variant: settle=ms, poll=ms, close=ms and faults, joined with '+'\n", argv0);
+}
+
+int main(int argc, char **argv) {
+  uint32_t count = 20;
+  double warmupHours = -1, hours = 0;
+  uint64_t seed = 1;
+  unsigned threads = std::thread::hardware_concurrency();
+  const char *loadPath = nullptr, *savePath = nullptr;
+  LotConfig config;
+  std::vector<Variant> variants(1);
+  variants[0].name = "unchanged";
+
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (!strcmp(arg, "-n") && hasValue) count = strtoul(argv[++i], nullptr, 10);
+    else if (!strcmp(arg, "-t") && hasValue) hours = strtod(argv[++i], nullptr);
+    else if (!strcmp(arg, "-s") && hasValue) seed = strtoull(argv[++i], nullptr, 10);
+    else if (!strcmp(arg, "-j") && hasValue) threads = strtoul(argv[++i], nullptr, 10);
+    else if (!strcmp(arg, "--spots") && hasValue) config.spots = atoi(argv[++i]);
+    else if (!strcmp(arg, "--rate") && hasValue) config.arrivalsPerHour = strtod(argv[++i], nullptr);
+    else if (!strcmp(arg, "--stay") && hasValue) config.meanStayMin = strtod(argv[++i], nullptr);
+    else if (!strcmp(arg, "--warmup") && hasValue) warmupHours = strtod(argv[++i], nullptr);
+    else if (!strcmp(arg, "--load") && hasValue) loadPath = argv[++i];
+    else if (!strcmp(arg, "--save") && hasValue) savePath = argv[++i];
+    else {
+      variants.emplace_back();
+      if (!parseVariant(arg, variants.back())) {
+        fprintf(stderr, "bad variant: %s\n", arg);
+        usage(argv[0]);
+        return 2;
+      }
+    }
+  }
+  if (!!loadPath == (warmupHours >= 0) || hours <= 0 || hours > 1000 || warmupHours > 1000 || !count ||
+      config.spots < 1 || config.spots > SIM_MAX_SPOTS || config.arrivalsPerHour <= 0) {
+    usage(argv[0]);
+    return 2;
+  }
+  if (!threads) threads = 1;
+
+  std::vector<Lot> lots;
+  if (loadPath) {
+    if (!loadCheckpoint(loadPath, lots, seed)) {
+      fprintf(stderr, "%s: not a checkpoint of this build\n", loadPath);
+      return 1;
+    }
+    printf("%zu lots from %s at %.2f h, seed %llu\n", lots.size(), loadPath, lots[0].nowMs() / 3600000.0,
+           (unsigned long long)seed);
+  } else {
+    lots.resize(count);
+    for (uint32_t i = 0; i < count; i++) lots[i].init(config, seed, i);
+    advanceAll(lots, (uint32_t)(warmupHours * 3600000), FaultPlan(), threads);
+    for (Lot &lot : lots) lot.resetStats();
+    printf("%u lots warmed up for %.2f h, %u spots, %.1f cars/h, seed %llu\n", count, warmupHours, config.spots,
+           config.arrivalsPerHour, (unsigned long long)seed);
+  }
+  if (savePath && !saveCheckpoint(savePath, lots, seed)) {
+    perror(savePath);
+    return 1;
+  }
+
+  uint32_t untilMs = lots[0].nowMs() + (uint32_t)(hours * 3600000);
+  unsigned childThreads = threads > variants.size() ? threads / variants.size() : 1;
+  std::vector<pid_t> children(variants.size());
+  std::vector<int> pipes(variants.size());
+  fflush(stdout);
+  for (size_t v = 0; v < variants.size(); v++) {
+    int fds[2];
+    if (pipe(fds) < 0 || (children[v] = fork()) < 0) {
+      perror("fork");
+      return 1;
+    }
+    if (children[v] == 0) {
+      close(fds[0]);
+      FleetResult result = runVariant(lots, variants[v], untilMs, childThreads);
+      _exit(writeAll(fds[1], &result, sizeof(result)) ? 0 : 1);
+    }
+    close(fds[1]);
+    pipes[v] = fds[0];
+  }
+
+  std::vector<FleetResult> results(variants.size());
+  std::vector<const char *> names(variants.size());
+  bool ok = true;
+  for (size_t v = 0; v < variants.size(); v++) {
+    names[v] = variants[v].name.c_str();
+    if (!readAll(pipes[v], &results[v], sizeof(results[v]))) {
+      fprintf(stderr, "variant %s failed\n", names[v]);
+      ok = false;
+    }
+    close(pipes[v]);
+    waitpid(children[v], nullptr, 0);
+  }
+  if (!ok) return 1;
+  printReport(names.data(), results.data(), variants.size(), lots.size() * hours);
+  return 0;
+}
@@ -0,0 +1,62 @@
+/**
+ * Latency histogram for simulator metrics.
+ *
+ * Log-linear buckets: exact below 4, then four buckets per power of two, so a
+ * percentile is off by at most a quarter octave. Plain data; histograms from
+ * different lots merge by adding buckets.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#define HIST_SUB_BUCKETS  4
+#define HIST_BUCKETS      (32 * HIST_SUB_BUCKETS)
+
+struct Histogram {
+  uint32_t buckets[HIST_BUCKETS];
+  uint64_t count;
+  uint64_t sum;
+  uint32_t max;
+
+  static uint32_t bucketOf(uint32_t v) {
+    if (v < HIST_SUB_BUCKETS) return v;
+    uint32_t octave = 31 - __builtin_clz(v);
+    return (octave - 1) * HIST_SUB_BUCKETS + ((v >> (octave - 2)) & (HIST_SUB_BUCKETS - 1));
+  }
+
+  // Largest value that lands in the bucket
+  static uint32_t upperBound(uint32_t bucket) {
+    if (bucket < HIST_SUB_BUCKETS) return bucket;
+    uint32_t octave = bucket / HIST_SUB_BUCKETS + 1, sub = bucket % HIST_SUB_BUCKETS;
+    uint64_t lower = (uint64_t)(HIST_SUB_BUCKETS + sub) << (octave - 2);
+    return (uint32_t)(lower + ((uint64_t)1 << (octave - 2)) - 1);
+  }
+
+  void add(uint32_t v) {
+    buckets[bucketOf(v)]++;
+    count++;
+    sum += v;
+    if (v > max) max = v;
+  }
+
+  void merge(const Histogram &other) {
+    for (int i = 0; i < HIST_BUCKETS; i++) buckets[i] += other.buckets[i];
+    count += other.count;
+    sum += other.sum;
+    if (other.max > max) max = other.max;
+  }
+
+  // Upper bound of the bucket holding the p-quantile (0 < p <= 1); 0 when empty
+  uint32_t percentile(double p) const {
+    if (!count) return 0;
+    uint64_t rank = (uint64_t)(p * count + 0.999999);
+    uint64_t seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+      seen += buckets[i];
+      if (seen >= rank) return upperBound(i) < max ? upperBound(i) : max;
+    }
+    return max;
+  }
+
+  double mean() const { return count ? (double)sum / count : 0; }
+};